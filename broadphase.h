@@ -0,0 +1,220 @@
+#pragma once
+
+// Sweep-and-prune broadphase over bound2f/bound3f.
+// Endpoints of every axis stay sorted between ticks, so with small motion the insertion sort does few swaps.
+// Swaps of min/max endpoints of different proxies are exactly the moments when pairs start or stop overlapping on that axis,
+// so overlapping pairs are kept persistently and each update reports only the pairs that were added or removed.
+//
+//   SweepAndPrune<bound3f> broadphase;
+//   std::uint32_t id = broadphase.add(bound);
+//   ...
+//   broadphase.move(id, newBound);
+//   broadphase.update();
+//   for (const BroadphasePair &p : broadphase.added()) ...
+
+#include <cstdint>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include "math.h"
+
+namespace math
+{
+    struct BroadphasePair {
+        std::uint32_t a;  // a < b
+        std::uint32_t b;
+    };
+
+    namespace imp {
+        template <typename> struct SweepAxes {};
+        template <> struct SweepAxes<bound2f> {
+            static constexpr std::size_t count = 2;
+
+            static scalar min(const bound2f &b, std::size_t axis) {
+                return axis == 0 ? b.xmin : b.ymin;
+            }
+            static scalar max(const bound2f &b, std::size_t axis) {
+                return axis == 0 ? b.xmax : b.ymax;
+            }
+        };
+        template <> struct SweepAxes<bound3f> {
+            static constexpr std::size_t count = 3;
+
+            static scalar min(const bound3f &b, std::size_t axis) {
+                return axis == 0 ? b.xmin : axis == 1 ? b.ymin : b.zmin;
+            }
+            static scalar max(const bound3f &b, std::size_t axis) {
+                return axis == 0 ? b.xmax : axis == 1 ? b.ymax : b.zmax;
+            }
+        };
+    }
+
+    template <typename Bound> class SweepAndPrune {
+    public:
+        using Axes = imp::SweepAxes<Bound>;
+
+        // New proxy starts overlapping its neighbours on the next update()
+        std::uint32_t add(const Bound &bound) {
+            std::uint32_t id;
+
+            if (_free.empty()) {
+                id = std::uint32_t(_proxies.size());
+                _proxies.push_back({});
+            }
+            else {
+                id = _free.back();
+                _free.pop_back();
+            }
+
+            _proxies[id] = {bound, true};
+
+            // appended endpoints lie past everything, as if the proxy came from infinity, and the sort brings them into place
+            for (std::size_t axis = 0; axis < Axes::count; axis++) {
+                _endpoints[axis].push_back({Axes::min(bound, axis), id, false});
+                _endpoints[axis].push_back({Axes::max(bound, axis), id, true});
+            }
+
+            return id;
+        }
+
+        // Pairs of the proxy are reported as removed on the next update(), id is reused after it
+        void remove(std::uint32_t id) {
+            if (id < _proxies.size() && _proxies[id].alive) {
+                _proxies[id].alive = false;
+                _dead.push_back(id);
+            }
+        }
+
+        void move(std::uint32_t id, const Bound &bound) {
+            _proxies[id].bound = bound;
+        }
+
+        const Bound &bound(std::uint32_t id) const {
+            return _proxies[id].bound;
+        }
+
+        // Applies add/remove/move since the last call, after it added() and removed() hold the difference in overlapping pairs
+        void update() {
+            _added.clear();
+            _removed.clear();
+
+            if (_dead.size()) {
+                _collect();
+            }
+
+            for (std::size_t axis = 0; axis < Axes::count; axis++) {
+                for (Endpoint &e : _endpoints[axis]) {
+                    e.value = e.isMax ? Axes::max(_proxies[e.id].bound, axis) : Axes::min(_proxies[e.id].bound, axis);
+                }
+
+                _sort(_endpoints[axis]);
+            }
+        }
+
+        const std::vector<BroadphasePair> &added() const {
+            return _added;
+        }
+
+        const std::vector<BroadphasePair> &removed() const {
+            return _removed;
+        }
+
+        bool overlapping(std::uint32_t a, std::uint32_t b) const {
+            return _pairs.count(_key(a, b)) != 0;
+        }
+
+        std::size_t pairCount() const {
+            return _pairs.size();
+        }
+
+        // f(const BroadphasePair &) for all currently overlapping pairs, in no particular order
+        template <typename F> void forEachPair(F &&f) const {
+            for (std::uint64_t key : _pairs) {
+                f(_pair(key));
+            }
+        }
+
+    private:
+        struct Proxy {
+            Bound bound;
+            bool alive;
+        };
+
+        struct Endpoint {
+            scalar value;
+            std::uint32_t id;
+            bool isMax;
+        };
+
+        std::vector<Proxy> _proxies;
+        std::vector<Endpoint> _endpoints[Axes::count];
+        std::vector<std::uint32_t> _free;
+        std::vector<std::uint32_t> _dead;
+        std::unordered_set<std::uint64_t> _pairs;
+        std::vector<BroadphasePair> _added;
+        std::vector<BroadphasePair> _removed;
+
+        static std::uint64_t _key(std::uint32_t a, std::uint32_t b) {
+            return a < b ? std::uint64_t(a) << 32 | b : std::uint64_t(b) << 32 | a;
+        }
+
+        static BroadphasePair _pair(std::uint64_t key) {
+            return {std::uint32_t(key >> 32), std::uint32_t(key & 0xffffffffu)};
+        }
+
+        // min goes before max on equal values, so touching bounds overlap as in bound::intersects
+        static bool _less(const Endpoint &e, const Endpoint &f) {
+            return e.value < f.value || (e.value == f.value && !e.isMax && f.isMax);
+        }
+
+        // Every inverted pair of endpoints is swapped exactly once and ends up in its final order,
+        // so a min passing a max is a possible start of overlap and a max passing a min is a certain end of it
+        void _sort(std::vector<Endpoint> &endpoints) {
+            for (std::size_t i = 1; i < endpoints.size(); i++) {
+                Endpoint e = endpoints[i];
+                std::size_t k = i;
+
+                for (; k > 0 && _less(e, endpoints[k - 1]); k--) {
+                    const Endpoint &f = endpoints[k - 1];
+
+                    if (e.isMax != f.isMax && e.id != f.id) {
+                        if (e.isMax) {
+                            if (_pairs.erase(_key(e.id, f.id))) {
+                                _removed.push_back(_pair(_key(e.id, f.id)));
+                            }
+                        }
+                        else if (_proxies[e.id].bound.intersects(_proxies[f.id].bound) && _pairs.insert(_key(e.id, f.id)).second) {
+                            _added.push_back(_pair(_key(e.id, f.id)));
+                        }
+                    }
+
+                    endpoints[k] = f;
+                }
+
+                endpoints[k] = e;
+            }
+        }
+
+        void _collect() {
+            for (auto it = _pairs.begin(); it != _pairs.end(); ) {
+                BroadphasePair p = _pair(*it);
+
+                if (_proxies[p.a].alive && _proxies[p.b].alive) {
+                    ++it;
+                }
+                else {
+                    _removed.push_back(p);
+                    it = _pairs.erase(it);
+                }
+            }
+            for (std::vector<Endpoint> &endpoints : _endpoints) {
+                endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(), [this](const Endpoint &e) {
+                    return !_proxies[e.id].alive;
+                }), endpoints.end());
+            }
+
+            _free.insert(_free.end(), _dead.begin(), _dead.end());
+            _dead.clear();
+        }
+    };
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+// Separating axis tests and contact generation for 2D shapes placed by transform2f.
+// Shapes are kept in world space: build them once per tick from local geometry and the object transform,
+// then test one shape against the candidates coming from a broadphase.
+
+#include <cstddef>
+#include <cassert>
+#include "math.h"
+
+namespace math
+{
+    constexpr std::size_t CONVEX2_MAX_VERTICES = 16;
+
+    // Oriented box: rectangle [-halfSize, halfSize] placed by transform2f. Scale of the transform goes into halfSize.
+    struct box2f {
+        vector2f center;
+        vector2f axisX;
+        vector2f axisY;
+        vector2f halfSize;
+
+        box2f() = default;
+        box2f(const vector2f &localHalfSize, const transform2f &trfm) {
+            vector2f ax = trfm.rows[0].xy;
+            vector2f ay = trfm.rows[1].xy;
+            center = trfm.translation();
+            axisX = ax.normalized();
+            axisY = ay.normalized();
+            halfSize = {localHalfSize.x * ax.length(), localHalfSize.y * ay.length()};
+        }
+
+        // half length of the box shadow on unit axis
+        scalar projectedRadius(const vector2f &axis) const {
+            return halfSize.x * std::abs(axisX.dot(axis)) + halfSize.y * std::abs(axisY.dot(axis));
+        }
+
+        bound2f bound() const {
+            scalar rx = projectedRadius(vector2f::positiveX());
+            scalar ry = projectedRadius(vector2f::positiveY());
+            return {center.x - rx, center.y - ry, center.x + rx, center.y + ry};
+        }
+    };
+
+    // Convex polygon with up to CONVEX2_MAX_VERTICES vertices in either winding. Keeps outward edge normals and bound.
+    struct convex2f {
+        vector2f vertices[CONVEX2_MAX_VERTICES];
+        vector2f normals[CONVEX2_MAX_VERTICES];  // normals[i] belongs to edge vertices[i] -> vertices[i + 1]
+        vector2f center;
+        bound2f bound;
+        std::size_t count = 0;
+
+        convex2f() = default;
+        // 'vertexCount' must be in [1, CONVEX2_MAX_VERTICES], release builds keep at most CONVEX2_MAX_VERTICES
+        convex2f(const vector2f *localVertices, std::size_t vertexCount, const transform2f &trfm) {
+            assert(vertexCount > 0 && vertexCount <= CONVEX2_MAX_VERTICES);
+            count = std::min(vertexCount, CONVEX2_MAX_VERTICES);
+
+            for (std::size_t i = 0; i < count; i++) {
+                vertices[i] = localVertices[i].transformed(trfm, true);
+            }
+
+            _finish();
+        }
+        convex2f(const box2f &box) {
+            vector2f dx = box.axisX * box.halfSize.x;
+            vector2f dy = box.axisY * box.halfSize.y;
+
+            count = 4;
+            vertices[0] = box.center - dx - dy;
+            vertices[1] = box.center + dx - dy;
+            vertices[2] = box.center + dx + dy;
+            vertices[3] = box.center - dx + dy;
+
+            _finish();
+        }
+
+        void project(const vector2f &axis, scalar &min, scalar &max) const {
+            min = max = vertices[0].dot(axis);
+
+            for (std::size_t i = 1; i < count; i++) {
+                scalar d = vertices[i].dot(axis);
+                min = std::min(min, d);
+                max = std::max(max, d);
+            }
+        }
+
+    private:
+        void _finish() {
+            scalar area = 0;
+            center = {0, 0};
+            bound = bound2f::empty();
+
+            for (std::size_t i = 0; i < count; i++) {
+                area += vertices[i].cross(vertices[(i + 1) % count]);
+                center = center + vertices[i];
+                bound = bound.merged(vertices[i]);
+            }
+
+            center = count ? center / scalar(count) : center;
+
+            // orthogonalLeft of an edge looks outside for positive (counter-clockwise) winding
+            for (std::size_t i = 0; i < count; i++) {
+                vector2f edge = vertices[(i + 1) % count] - vertices[i];
+                normals[i] = (area > scalar(0.0) ? edge.orthogonalLeft() : edge.orthogonalRight()).normalized();
+            }
+        }
+    };
+
+    // Contact of shape 'a' with shape 'b'
+    struct contact2f {
+        vector2f normal;          // unit, from a to b
+        scalar depth;             // penetration along normal
+        vector2f points[2];       // contact points on the incident shape surface
+        scalar depths[2];
+        std::size_t pointCount;
+    };
+
+    namespace imp {
+        // depth of overlap on axis, negative if separated
+        inline scalar overlapOnAxis(const convex2f &a, const convex2f &b, const vector2f &axis) {
+            scalar amin, amax, bmin, bmax;
+            a.project(axis, amin, amax);
+            b.project(axis, bmin, bmax);
+            return std::min(amax - bmin, bmax - amin);
+        }
+
+        // smallest overlap over normals of 'owner', false if any of them separates
+        inline bool minimalOverlap(const convex2f &owner, const convex2f &other, scalar &depth, std::size_t &index) {
+            depth = std::numeric_limits<scalar>::max();
+
+            for (std::size_t i = 0; i < owner.count; i++) {
+                scalar d = overlapOnAxis(owner, other, owner.normals[i]);
+
+                if (d < scalar(0.0)) {
+                    return false;
+                }
+                if (d < depth) {
+                    depth = d;
+                    index = i;
+                }
+            }
+
+            return true;
+        }
+
+        inline std::size_t mostAligned(const convex2f &shape, const vector2f &direction) {
+            std::size_t result = 0;
+
+            for (std::size_t i = 1; i < shape.count; i++) {
+                result = shape.normals[i].dot(direction) > shape.normals[result].dot(direction) ? i : result;
+            }
+
+            return result;
+        }
+
+        // keeps part of segment where dot(p, n) <= offset
+        inline std::size_t clipSegment(const vector2f (&in)[2], vector2f (&out)[2], const vector2f &n, scalar offset) {
+            std::size_t count = 0;
+            scalar d0 = in[0].dot(n) - offset;
+            scalar d1 = in[1].dot(n) - offset;
+
+            if (d0 <= scalar(0.0)) out[count++] = in[0];
+            if (d1 <= scalar(0.0)) out[count++] = in[1];
+            if (d0 * d1 < scalar(0.0)) out[count++] = in[0].lerpTo(in[1], d0 / (d0 - d1));
+
+            return count;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------------------------------------------------------------------
+    // overlap queries
+
+    inline bool overlaps(const box2f &a, const box2f &b) {
+        vector2f d = b.center - a.center;
+        const vector2f *axes[4] = {&a.axisX, &a.axisY, &b.axisX, &b.axisY};
+
+        for (const vector2f *axis : axes) {
+            if (std::abs(d.dot(*axis)) > a.projectedRadius(*axis) + b.projectedRadius(*axis)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline bool overlaps(const convex2f &a, const convex2f &b) {
+        scalar depth;
+        std::size_t index;
+        return a.bound.intersects(b.bound) && imp::minimalOverlap(a, b, depth, index) && imp::minimalOverlap(b, a, depth, index);
+    }
+
+    //------------------------------------------------------------------------------------------------------------------------------------------------------
+    // contact generation: axis of least penetration, then incident edge clipped by the reference edge side planes
+
+    inline bool collide(const convex2f &a, const convex2f &b, contact2f &contact) {
+        scalar depthA, depthB;
+        std::size_t indexA = 0, indexB = 0;
+
+        if (!a.bound.intersects(b.bound) || !imp::minimalOverlap(a, b, depthA, indexA) || !imp::minimalOverlap(b, a, depthB, indexB)) {
+            return false;
+        }
+
+        // small bias keeps reference face stable when depths are nearly equal
+        bool referenceIsA = depthA <= depthB + scalar(0.0005);
+        const convex2f &reference = referenceIsA ? a : b;
+        const convex2f &incident = referenceIsA ? b : a;
+        vector2f axis = referenceIsA ? a.normals[indexA] : b.normals[indexB];
+
+        // least overlap may be on the far side of the axis, turn it from reference to incident
+        axis = (incident.center - reference.center).dot(axis) < scalar(0.0) ? -axis : axis;
+
+        std::size_t referenceIndex = imp::mostAligned(reference, axis);
+        std::size_t incidentIndex = imp::mostAligned(incident, -axis);
+        vector2f referenceNormal = reference.normals[referenceIndex];
+        vector2f v0 = reference.vertices[referenceIndex];
+        vector2f v1 = reference.vertices[(referenceIndex + 1) % reference.count];
+        vector2f tangent = (v1 - v0).normalized();
+        vector2f segment[2] = {incident.vertices[incidentIndex], incident.vertices[(incidentIndex + 1) % incident.count]};
+        vector2f clipped0[2], clipped1[2];
+        std::size_t clippedCount = 0;
+
+        if (imp::clipSegment(segment, clipped0, -tangent, -tangent.dot(v0)) == 2) {
+            clippedCount = imp::clipSegment(clipped0, clipped1, tangent, tangent.dot(v1));
+        }
+
+        contact.normal = referenceIsA ? axis : -axis;
+        contact.depth = referenceIsA ? depthA : depthB;
+        contact.pointCount = 0;
+
+        for (std::size_t i = 0; i < clippedCount; i++) {
+            scalar separation = (clipped1[i] - v0).dot(referenceNormal);
+
+            if (separation <= scalar(0.0)) {
+                contact.points[contact.pointCount] = clipped1[i];
+                contact.depths[contact.pointCount++] = -separation;
+            }
+        }
+
+        // degenerate clipping, fall back to the deepest incident vertex
+        if (contact.pointCount == 0) {
+            std::size_t deepest = 0;
+
+            for (std::size_t i = 1; i < incident.count; i++) {
+                deepest = incident.vertices[i].dot(axis) < incident.vertices[deepest].dot(axis) ? i : deepest;
+            }
+
+            contact.points[0] = incident.vertices[deepest];
+            contact.depths[0] = contact.depth;
+            contact.pointCount = 1;
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------------------------------------------------------------------------------
+    // batch: one shape against broadphase candidates
+
+    // Writes contact and candidate index for every candidate touching 'shape', returns number of written contacts
+    inline std::size_t collide(const convex2f &shape, const convex2f *candidates, std::size_t count, contact2f *contacts, std::size_t *indices) {
+        std::size_t result = 0;
+
+        for (std::size_t i = 0; i < count; i++) {
+            if (shape.bound.intersects(candidates[i].bound) && collide(shape, candidates[i], contacts[result])) {
+                indices[result++] = i;
+            }
+        }
+
+        return result;
+    }
+
+    // Writes indices of boxes overlapping 'box', returns their number
+    inline std::size_t overlaps(const box2f &box, const box2f *candidates, std::size_t count, std::size_t *indices) {
+        std::size_t result = 0;
+
+        for (std::size_t i = 0; i < count; i++) {
+            if (overlaps(box, candidates[i])) {
+                indices[result++] = i;
+            }
+        }
+
+        return result;
+    }
+}
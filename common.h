@@ -1,6 +1,15 @@
 
+#pragma once
 #include <sstream>
 #include <iomanip>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
 
 namespace utility {
     class NonCopyable
@@ -36,4 +45,236 @@ namespace utility {
         (stream >> std::ws).peek() == Ch ? (void)stream.ignore() : stream.setstate(std::ios_base::failbit);
         return expect<Chs...>(stream);
     }
+
+    // Threads kept for the process lifetime, so per-frame parallel work doesn't pay thread creation and joining.
+    // Threads are started on demand, up to the largest task count asked for so far.
+    class WorkerPool : NonCopyable {
+    public:
+        static WorkerPool &instance() {
+            static WorkerPool pool;
+            return pool;
+        }
+
+        ~WorkerPool() {
+            {
+                std::lock_guard<std::mutex> lock (_mutex);
+                _stop = true;
+            }
+
+            _wake.notify_all();
+
+            for (std::thread &thread : _threads) {
+                thread.join();
+            }
+        }
+
+        // Calls task(context, i) for i in [0, count): 0 on the calling thread, the rest on workers. Returns when all are done.
+        // Everything runs on the calling thread if it is a worker itself or another thread is using the pool.
+        void run(std::size_t count, void (*task)(void *, std::size_t), void *context) {
+            std::unique_lock<std::mutex> busy (_busy, std::try_to_lock);
+
+            if (count < 2 || _isWorker() || busy.owns_lock() == false) {
+                for (std::size_t i = 0; i < count; i++) {
+                    task(context, i);
+                }
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock (_mutex);
+
+                while (_threads.size() < count - 1) {
+                    _threads.emplace_back([this] {
+                        _work();
+                    });
+                }
+
+                _task = task;
+                _context = context;
+                _next = 1;
+                _count = count;
+                _pending = count - 1;
+            }
+
+            _wake.notify_all();
+            task(context, 0);
+
+            std::unique_lock<std::mutex> lock (_mutex);
+            _done.wait(lock, [this] {
+                return _pending == 0;
+            });
+        }
+
+    private:
+        std::vector<std::thread> _threads;
+        std::mutex _busy;   // held by the thread running a job
+        std::mutex _mutex;  // guards the job state below
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        void (*_task)(void *, std::size_t) = nullptr;
+        void *_context = nullptr;
+        std::size_t _next = 0;
+        std::size_t _count = 0;
+        std::size_t _pending = 0;
+        bool _stop = false;
+
+        WorkerPool() = default;
+
+        static bool &_isWorker() {
+            thread_local static bool worker = false;
+            return worker;
+        }
+
+        void _work() {
+            _isWorker() = true;
+            std::unique_lock<std::mutex> lock (_mutex);
+
+            while (true) {
+                _wake.wait(lock, [this] {
+                    return _stop || _next < _count;
+                });
+
+                if (_stop) {
+                    return;
+                }
+
+                std::size_t index = _next++;
+                lock.unlock();
+                _task(_context, index);
+                lock.lock();
+
+                if (--_pending == 0) {
+                    _done.notify_one();
+                }
+            }
+        }
+    };
+
+    // Splits [0, count) into at most threadCount slices (multiples of granularity) and runs functor(begin, end, slot) for each of them
+    // on WorkerPool, the first slice on the calling thread. threadCount == 0 means std::thread::hardware_concurrency().
+    template <typename L> void parallelFor(std::size_t count, std::size_t threadCount, std::size_t granularity, L &&functor) {
+        threadCount = threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        granularity = std::max(std::size_t(1), granularity);
+
+        std::size_t sliceCount = std::min(threadCount, (count + granularity - 1) / granularity);
+        std::size_t slice = sliceCount ? ((count + sliceCount - 1) / sliceCount + granularity - 1) / granularity * granularity : 0;
+
+        struct Job {
+            std::remove_reference_t<L> &functor;
+            std::size_t count;
+            std::size_t slice;
+        } job {functor, count, slice};
+
+        WorkerPool::instance().run(slice ? (count + slice - 1) / slice : 0, [](void *context, std::size_t i) {
+            Job &job = *static_cast<Job *>(context);
+            std::size_t begin = i * job.slice;
+            job.functor(begin, std::min(job.count, begin + job.slice), i);
+        }, &job);
+    }
+
+    // Allocation and locale free counterpart of std::istream for delimited text. Numbers are read with std::from_chars.
+    // Like the stream, scanner becomes failed on the first mismatch and ignores everything after that.
+    class TextScanner {
+    public:
+        TextScanner(std::string_view text) : _current(text.data()), _end(text.data() + text.size()) {}
+
+        explicit operator bool() const {
+            return !_failed;
+        }
+
+        TextScanner &skipws() {
+            while (_current != _end && (*_current == ' ' || *_current == '\t' || *_current == '\n' || *_current == '\r')) {
+                _current++;
+            }
+            return *this;
+        }
+
+        char peek() const {
+            return _current != _end ? *_current : '\0';
+        }
+
+        void ignore() {
+            _current += _current != _end ? 1 : 0;
+        }
+
+        void fail() {
+            _failed = true;
+        }
+
+        bool eof() {
+            return skipws()._current == _end;
+        }
+
+        std::string_view rest() const {
+            return std::string_view(_current, std::size_t(_end - _current));
+        }
+
+        template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>> TextScanner &operator >>(T &value) {
+            if (!_failed) {
+                std::from_chars_result result = std::from_chars(skipws()._current, _end, value);
+                result.ec == std::errc() ? (void)(_current = result.ptr) : fail();
+            }
+            return *this;
+        }
+
+    private:
+        const char *_current;
+        const char *_end;
+        bool _failed = false;
+    };
+
+    template <typename = void> TextScanner &expect(TextScanner &scanner) {
+        return scanner;
+    }
+    template <char Ch, char... Chs> TextScanner &expect(TextScanner &scanner) {
+        scanner.skipws().peek() == Ch ? scanner.ignore() : scanner.fail();
+        return expect<Chs...>(scanner);
+    }
+
+    // Writes text into caller's buffer with std::to_chars (shortest round-trip form for floating point).
+    // Becomes failed when buffer is exhausted and ignores further output, so text() is always a valid prefix of the output.
+    class TextPrinter {
+    public:
+        TextPrinter(char *first, char *last) : _begin(first), _current(first), _end(last) {}
+        template <std::size_t N> TextPrinter(char (&buffer)[N]) : TextPrinter(buffer, buffer + N) {}
+
+        explicit operator bool() const {
+            return !_failed;
+        }
+
+        std::string_view text() const {
+            return std::string_view(_begin, std::size_t(_current - _begin));
+        }
+
+        TextPrinter &operator <<(char ch) {
+            if (!_failed) {
+                _current != _end ? (void)(*_current++ = ch) : fail();
+            }
+            return *this;
+        }
+
+        TextPrinter &operator <<(std::string_view text) {
+            if (!_failed) {
+                std::size_t(_end - _current) >= text.size() ? (void)(_current = std::copy(text.begin(), text.end(), _current)) : fail();
+            }
+            return *this;
+        }
+
+        template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>> TextPrinter &operator <<(T value) {
+            if (!_failed) {
+                std::to_chars_result result = std::to_chars(_current, _end, value);
+                result.ec == std::errc() ? (void)(_current = result.ptr) : fail();
+            }
+            return *this;
+        }
+
+    private:
+        char *_begin;
+        char *_current;
+        char *_end;
+        bool _failed = false;
+
+        void fail() {
+            _failed = true;
+        }
+    };
 }
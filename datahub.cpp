@@ -2,6 +2,7 @@
 #include "datahub.h"
 #include <limits>
 #include <cassert>
+#include <thread>
 
 #define CHECK(x) assert(x)
 
@@ -35,6 +36,102 @@ namespace datahub {
             unittest.teststring = "ccc";
             CHECK(firedEventCount == 3);
         }
+
+        // EventHandler token reuse tests
+        {
+            int firedA = 0, firedB = 0, firedC = 0;
+            datahub::EventToken tokenA = unittest.testvalue.onValueChanged += [&firedA](int) { firedA++; };
+            datahub::EventToken tokenB = unittest.testvalue.onValueChanged += [&firedB](int) { firedB++; };
+
+            unittest.testvalue.onValueChanged -= tokenA;
+            datahub::EventToken tokenC = unittest.testvalue.onValueChanged += [&firedC](int) { firedC++; };
+
+            CHECK(tokenC != tokenA && tokenC != tokenB);
+            unittest.testvalue.onValueChanged -= tokenA;
+            unittest.testvalue = 1;
+            CHECK(firedA == 0 && firedB == 1 && firedC == 1);
+
+            unittest.testvalue.onValueChanged -= tokenB;
+            unittest.testvalue = 2;
+            CHECK(firedB == 1 && firedC == 2);
+
+            unittest.testvalue.onValueChanged -= tokenC;
+            unittest.testvalue.onValueChanged -= tokenC;
+            unittest.testvalue = 99;
+            CHECK(firedA == 0 && firedB == 1 && firedC == 2);
+        }
+
+        // EventHandler dispatch tests: handlers removing themselves and adding others while called
+        {
+            int firedSelf = 0, firedB = 0, firedC = 0, firedAdded = 0;
+            datahub::EventToken self = nullptr, added = nullptr;
+
+            self = unittest.testvalue.onValueChanged += [&firedSelf, &self](int) {
+                firedSelf++;
+                unittest.testvalue.onValueChanged -= self;
+            };
+            datahub::EventToken tokenB = unittest.testvalue.onValueChanged += [&firedB, &firedAdded, &added](int) {
+                firedB++;
+
+                if (added == nullptr) {
+                    added = unittest.testvalue.onValueChanged += [&firedAdded](int) { firedAdded++; };
+                }
+            };
+            datahub::EventToken tokenC = unittest.testvalue.onValueChanged += [&firedC](int) { firedC++; };
+
+            unittest.testvalue = 1;
+            CHECK(firedSelf == 1 && firedB == 1 && firedC == 1 && firedAdded == 0);
+
+            unittest.testvalue = 2;
+            CHECK(firedSelf == 1 && firedB == 2 && firedC == 2 && firedAdded == 1);
+
+            unittest.testvalue.onValueChanged -= tokenB;
+            unittest.testvalue.onValueChanged -= tokenC;
+            unittest.testvalue.onValueChanged -= added;
+            unittest.testvalue = 99;
+            CHECK(firedB == 2 && firedC == 2 && firedAdded == 1);
+        }
+
+        // EventHandler inline capture tests: captured objects survive being moved around the handler array
+        {
+            std::string seen;
+            std::string prefix = "value changed to ";
+            datahub::EventToken token0 = unittest.testvalue.onValueChanged += [&seen](int) { seen += "|"; };
+            datahub::EventToken token1 = unittest.testvalue.onValueChanged += [&seen, prefix](int value) { seen += prefix + std::to_string(value); };
+
+            unittest.testvalue.onValueChanged -= token0;
+            unittest.testvalue = 7;
+            CHECK(seen == "value changed to 7");
+
+            unittest.testvalue.onValueChanged -= token1;
+            unittest.testvalue = 99;
+            CHECK(seen == "value changed to 7");
+        }
+
+        // InlineDelegate tests: moving a moved-from delegate neither relocates nor destroys its capture again
+        {
+            struct Probe {
+                int *destroyed;
+                Probe(int *counter) : destroyed(counter) {}
+                Probe(Probe &&other) noexcept : destroyed(other.destroyed) {}
+                ~Probe() { ++*destroyed; }
+                void operator()(int) {}
+            };
+
+            int destroyed = 0;
+            datahub::details::InlineDelegate<void(int)> a = Probe(&destroyed);
+            datahub::details::InlineDelegate<void(int)> b = std::move(a);
+            int before = destroyed;
+
+            datahub::details::InlineDelegate<void(int)> c = std::move(a);
+            c = std::move(a);
+            b(1);
+            CHECK(destroyed == before);
+
+            c = std::move(b);
+            c(1);
+            CHECK(destroyed == before + 1);
+        }
         
         // Value tests
         {
@@ -85,6 +182,169 @@ namespace datahub {
             CHECK(::strcmp(s, "true") == 0);
         }
         
+        // Change policy tests: writes of equal values do not notify
+        {
+            int stringEvents = 0, valueEvents = 0, boolEvents = 0, floatEvents = 0;
+            datahub::EventToken stringToken = unittest.teststring.onValueChanged += [&stringEvents](const char *) { stringEvents++; };
+            datahub::EventToken valueToken = unittest.testvalue.onValueChanged += [&valueEvents](int) { valueEvents++; };
+            datahub::EventToken boolToken = unittest.testbool.onValueChanged += [&boolEvents](bool) { boolEvents++; };
+            datahub::EventToken floatToken = unittest.testfloat.onValueChanged += [&floatEvents](float) { floatEvents++; };
+
+            unittest.teststring = "same";
+            unittest.teststring = "same";
+            unittest.testvalue = 5;
+            unittest.testvalue = 5.4;
+            unittest.testvalue = "5";
+            unittest.testbool = false;
+            unittest.testbool = "false";
+            unittest.testbool = true;
+            unittest.testfloat = 0.25f;
+            unittest.testfloat = 0.25f + std::numeric_limits<float>::epsilon() / 4;
+            unittest.testfloat = 0.5f;
+
+            CHECK(stringEvents == 1 && valueEvents == 1 && boolEvents == 2 && floatEvents == 2);
+
+            // epsilon is relative: neighbouring floats are equal at large magnitudes, small values still change
+            unittest.testfloat = 1000000.0f;
+            unittest.testfloat = std::nextafter(1000000.0f, 2000000.0f);
+            unittest.testfloat = 1e-9f;
+            unittest.testfloat = 2e-9f;
+            CHECK(floatEvents == 5);
+
+            // unchanged writes are dropped, so the stored value stays what handlers saw
+            unittest.testfloat = 1.0;
+            unittest.testfloat = 1.0 + 1e-9;
+            CHECK(floatEvents == 6 && double(unittest.testfloat) == 1.0);
+            unittest.testfloat = 0.5f;
+
+            // types without == always notify and only need assignment from the written type
+            struct Assignable {
+                int value = 0;
+                Assignable &operator =(int v) { value = v; return *this; }
+            };
+
+            int assignableEvents = 0;
+            datahub::details::ObservableValue<Assignable> assignable (0);
+            assignable.onValueChanged += [&assignableEvents](const Assignable &) { assignableEvents++; };
+            assignable = 7;
+            assignable = 7;
+            CHECK(assignableEvents == 2 && static_cast<Assignable &>(assignable).value == 7);
+            CHECK(datahub::ChangeDetection<float>::policy == datahub::ChangePolicy::Epsilon);
+            CHECK(datahub::ChangeDetection<std::string>::policy == datahub::ChangePolicy::Inequality);
+
+            unittest.teststring.onValueChanged -= stringToken;
+            unittest.testvalue.onValueChanged -= valueToken;
+            unittest.testbool.onValueChanged -= boolToken;
+            unittest.testfloat.onValueChanged -= floatToken;
+        }
+
+        // Transaction tests
+        {
+            int firedEventCount = 0;
+            int lastValue = 0;
+            datahub::EventToken token = unittest.testvalue.onValueChanged += [&firedEventCount, &lastValue](int value) {
+                firedEventCount++;
+                lastValue = value;
+            };
+
+            {
+                datahub::Transaction transaction;
+                unittest.testvalue = 1;
+                unittest.testvalue = 2;
+                {
+                    datahub::Transaction nested;
+                    unittest.testvalue = 3;
+                }
+                CHECK(firedEventCount == 0);
+            }
+
+            CHECK(firedEventCount == 1 && lastValue == 3);
+
+            datahub::setFrameMode(true);
+            unittest.testvalue = 4;
+            {
+                datahub::Transaction transaction;
+                unittest.testvalue = 5;
+            }
+            CHECK(firedEventCount == 1);
+
+            datahub::flush();
+            datahub::setFrameMode(false);
+            CHECK(firedEventCount == 2 && lastValue == 5);
+
+            // turning frame mode off sends what is delayed, frame mode of one thread doesn't delay writes on another
+            datahub::setFrameMode(true);
+            std::thread([] { unittest.testvalue = 6; }).join();
+            CHECK(firedEventCount == 3 && lastValue == 6);
+
+            unittest.testvalue = 5;
+            CHECK(firedEventCount == 3);
+            datahub::setFrameMode(false);
+            CHECK(firedEventCount == 4 && lastValue == 5);
+
+            // values destroyed before flush are skipped
+            {
+                datahub::Transaction transaction;
+                datahub::ArrayToken element = unittest.testarray.add([](unittest::ArrayElement &) {});
+                unittest.testarray[element].teststring = "changed";
+                unittest.testarray.remove(element);
+                unittest.testvalue = 99;
+            }
+
+            CHECK(firedEventCount == 5 && lastValue == 99);
+
+            // value set back to what handlers saw last is not notified
+            {
+                datahub::Transaction transaction;
+                unittest.testvalue = 5;
+                unittest.testvalue = 99;
+            }
+
+            CHECK(firedEventCount == 5);
+
+            // handler with a transaction of its own during flush: its writes are notified in the same flush, nothing twice
+            int boolEvents = 0;
+            bool initialBool = unittest.testbool;
+            datahub::EventToken boolToken = unittest.testbool.onValueChanged += [&boolEvents](bool) {
+                boolEvents++;
+            };
+            datahub::EventToken chainToken = unittest.testvalue.onValueChanged += [](int) {
+                datahub::Transaction transaction;
+                unittest.testbool = !unittest.testbool;
+            };
+
+            {
+                datahub::Transaction transaction;
+                unittest.testvalue = 101;
+            }
+
+            CHECK(firedEventCount == 6 && lastValue == 101 && boolEvents == 1 && unittest.testbool != initialBool);
+
+            unittest.testvalue.onValueChanged -= chainToken;
+            unittest.testbool.onValueChanged -= boolToken;
+            unittest.testbool = initialBool;
+            unittest.testvalue = 99;
+            unittest.testvalue.onValueChanged -= token;
+
+            // changed value moved by removal of another element is notified at its new place
+            std::string notified;
+            datahub::ArrayToken first = unittest.testarray.add([](unittest::ArrayElement &) {});
+            datahub::ArrayToken last = unittest.testarray.add([&notified](unittest::ArrayElement &element) {
+                element.teststring.onValueChanged += [&notified](const char *value) {
+                    notified = value;
+                };
+            });
+
+            {
+                datahub::Transaction transaction;
+                unittest.testarray[last].teststring = "moved";
+                unittest.testarray.remove(first);
+            }
+
+            CHECK(notified == "moved");
+            unittest.testarray.remove(last);
+        }
+
         // Array tests
         {
             int firedEventCount = 0;
@@ -96,13 +356,13 @@ namespace datahub {
                 firedEventCount++;
             };
 
-            datahub::ArrayToken token0 = unittest.testarray.addArrayElement([](unittest::ArrayElement &element) {
+            datahub::ArrayToken token0 = unittest.testarray.add([](unittest::ArrayElement &element) {
                 element.teststring = 1;
             });
             
             CHECK(firedEventCount == 1);
             
-            datahub::ArrayToken token1 = unittest.testarray.addArrayElement([](unittest::ArrayElement &element) {
+            datahub::ArrayToken token1 = unittest.testarray.add([](unittest::ArrayElement &element) {
                 element.teststring = 2;
             });
             
@@ -110,15 +370,135 @@ namespace datahub {
             CHECK(unittest.testarray[token0].teststring == "1");
             CHECK(unittest.testarray[token1].teststring == "2");
 
-            unittest.testarray.removeArrayElement(token0);
+            unittest.testarray.remove(token0);
             
             CHECK(firedEventCount == 3);
             CHECK(unittest.testarray[token1].teststring == "2");
 
-            unittest.testarray.removeArrayElement(token1);
+            unittest.testarray.remove(token1);
+            unittest.testarray.onArrayElementAdded -= eventAdd;
+            unittest.testarray.onArrayElementRemoving -= eventRemove;
+
+        }
+
+        // Array storage tests: swap-remove keeps the other elements reachable, stale tokens find nothing
+        {
+            datahub::ArrayToken tokens[4];
+
+            for (int i = 0; i < 4; i++) {
+                tokens[i] = unittest.testarray.add([i](unittest::ArrayElement &element) {
+                    element.teststring = i;
+                });
+            }
+
+            unittest.testarray.remove(tokens[1]);
+            unittest.testarray.remove(tokens[1]);
+            datahub::ArrayToken token4 = unittest.testarray.add([](unittest::ArrayElement &element) {
+                element.teststring = 4;
+            });
+
+            CHECK(unittest.testarray.size() == 4);
+            CHECK(token4 != tokens[1] && unittest.testarray.find(tokens[1]) == nullptr);
+            CHECK(unittest.testarray[tokens[0]].teststring == "0");
+            CHECK(unittest.testarray[tokens[2]].teststring == "2");
+            CHECK(unittest.testarray[tokens[3]].teststring == "3");
+            CHECK(unittest.testarray.find(token4)->teststring == "4");
+
+            int visited = 0;
+            unittest.testarray.foreach([&visited](datahub::ArrayToken token, unittest::ArrayElement &element) {
+                visited += unittest.testarray.find(token) == &element ? 1 : 0;
+            });
+
+            CHECK(visited == 4);
+
+            for (datahub::ArrayToken token : {tokens[0], tokens[2], tokens[3], token4}) {
+                unittest.testarray.remove(token);
+            }
+
+            CHECK(unittest.testarray.size() == 0);
+        }
+
+        // Array range tests: one range event per operation next to the per-element ones
+        {
+            int addedEvents = 0, removingEvents = 0, addedRanges = 0, removingRanges = 0;
+            std::size_t lastRange = 0;
+
+            datahub::EventToken eventAdd = unittest.testarray.onArrayElementAdded += [&addedEvents](datahub::ArrayToken, unittest::ArrayElement &) {
+                addedEvents++;
+            };
+            datahub::EventToken eventRemove = unittest.testarray.onArrayElementRemoving += [&removingEvents](datahub::ArrayToken) {
+                removingEvents++;
+            };
+            datahub::EventToken eventAddRange = unittest.testarray.onArrayRangeAdded += [&addedRanges, &lastRange](const datahub::ArrayToken *tokens, std::size_t count) {
+                addedRanges++;
+                lastRange = count;
+                CHECK(unittest.testarray[tokens[count - 1]].teststring == "99");
+            };
+            datahub::EventToken eventRemoveRange = unittest.testarray.onArrayRangeRemoving += [&removingRanges, &lastRange](const datahub::ArrayToken *tokens, std::size_t count) {
+                removingRanges++;
+                lastRange = count;
+                CHECK(unittest.testarray.find(tokens[0]) != nullptr);
+            };
+
+            datahub::ArrayToken tokens[100];
+            unittest.testarray.addRange(100, [](unittest::ArrayElement &element, std::size_t index) {
+                element.teststring = int(index);
+            }, tokens);
+
+            CHECK(unittest.testarray.size() == 100 && addedEvents == 100 && addedRanges == 1 && lastRange == 100);
+            CHECK(unittest.testarray[tokens[42]].teststring == "42");
+
+            // tokens 10..29 and a stale one
+            unittest.testarray.removeRange(tokens + 10, 20);
+            unittest.testarray.removeRange(tokens + 10, 1);
+
+            CHECK(unittest.testarray.size() == 80 && removingEvents == 20 && removingRanges == 1 && lastRange == 20);
+            CHECK(unittest.testarray.find(tokens[10]) == nullptr && unittest.testarray[tokens[99]].teststring == "99");
+
+            unittest.testarray.clear();
+
+            CHECK(unittest.testarray.size() == 0 && removingEvents == 100 && removingRanges == 2 && lastRange == 80);
+            CHECK(unittest.testarray.find(tokens[0]) == nullptr && unittest.testarray.find(tokens[99]) == nullptr);
+
             unittest.testarray.onArrayElementAdded -= eventAdd;
             unittest.testarray.onArrayElementRemoving -= eventRemove;
+            unittest.testarray.onArrayRangeAdded -= eventAddRange;
+            unittest.testarray.onArrayRangeRemoving -= eventRemoveRange;
+        }
+
+        // Array range nesting tests: repeated tokens are removed once, range calls from handlers keep the outer range intact
+        {
+            int removingEvents = 0, removingRanges = 0;
+            bool intact = true;
+            datahub::ArrayToken tokens[10];
+
+            unittest.testarray.addRange(10, [](unittest::ArrayElement &element, std::size_t index) {
+                element.teststring = int(index);
+            }, tokens);
 
+            datahub::EventToken eventRemove = unittest.testarray.onArrayElementRemoving += [&removingEvents](datahub::ArrayToken) {
+                removingEvents++;
+            };
+            datahub::EventToken eventRemoveRange = unittest.testarray.onArrayRangeRemoving += [&removingRanges, &intact, &tokens](const datahub::ArrayToken *ids, std::size_t count) {
+                if (removingRanges++ == 0) {
+                    std::vector<datahub::ArrayToken> before (ids, ids + count);
+                    unittest.testarray.removeRange(tokens + 5, 2);
+                    unittest.testarray.addRange(3, [](unittest::ArrayElement &, std::size_t) {});
+                    intact = std::equal(before.begin(), before.end(), ids);
+                }
+            };
+
+            datahub::ArrayToken repeated[6] = {tokens[0], tokens[1], tokens[0], tokens[2], tokens[1], tokens[9]};
+            unittest.testarray.removeRange(repeated, 6);
+
+            CHECK(intact && removingRanges == 2 && removingEvents == 6);
+            CHECK(unittest.testarray.size() == 7 && unittest.testarray.find(tokens[1]) == nullptr && unittest.testarray.find(tokens[5]) == nullptr);
+            CHECK(unittest.testarray[tokens[3]].teststring == "3" && unittest.testarray[tokens[8]].teststring == "8");
+
+            unittest.testarray.onArrayElementRemoving -= eventRemove;
+            unittest.testarray.onArrayRangeRemoving -= eventRemoveRange;
+            unittest.testarray.clear();
+            CHECK(unittest.testarray.size() == 0);
         }
     }
 }
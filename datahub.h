@@ -1,7 +1,12 @@
 #pragma once
 #include <vector>
-#include <unordered_map>
-#include <functional>
+#include <cstdint>
+#include <limits>
+#include <cassert>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <cstddef>
 #include <string>
 #include <strstream>
 #include <cmath>
@@ -10,6 +15,11 @@
     #define strcasecmp _stricmp
 #endif
 
+// Capture size limit of event handler lambdas, handlers are stored inline without heap allocations
+#ifndef DATAHUB_HANDLER_CAPACITY
+    #define DATAHUB_HANDLER_CAPACITY (6 * sizeof(void *))
+#endif
+
 #define datahubscope(name, ...) struct name : datahub::details::MovableBase __VA_ARGS__ name;
 #define datahubarray(structname, arrayname, ...) struct structname : datahub::details::MovableBase __VA_ARGS__; datahub::details::ObservableArray<structname> arrayname;
 #define datahubvalue(name, ...) datahub::details::ObservableValue<decltype(__VA_ARGS__)> name = __VA_ARGS__;
@@ -36,67 +46,546 @@ namespace datahub {
     typedef struct {} * EventToken;
     typedef struct {} * ArrayToken;
 
+    // When a write to a value sends onValueChanged
+    enum class ChangePolicy {
+        Always,      // on every write
+        Inequality,  // if new value != old value
+        Epsilon,     // if |new value - old value| > ChangeDetection<Type>::epsilon() * max(|new value|, |old value|)
+    };
+
+    namespace details {
+        template<typename Type, typename = void> struct IsEqualityComparable : std::false_type {};
+        template<typename Type> struct IsEqualityComparable<Type, decltype(void(std::declval<const Type &>() == std::declval<const Type &>()))> : std::true_type {};
+    }
+
+    // Change policy of value types: floating point types use epsilon, other types with == use inequality, the rest always notify.
+    // Strings are compared as std::string. Specialize for own types:
+    //
+    //   template<> struct datahub::ChangeDetection<Layout> { static constexpr datahub::ChangePolicy policy = datahub::ChangePolicy::Always; };
+    template<typename Type, typename = void> struct ChangeDetection {
+        static constexpr ChangePolicy policy = details::IsEqualityComparable<Type>::value ? ChangePolicy::Inequality : ChangePolicy::Always;
+    };
+    template<typename Type> struct ChangeDetection<Type, std::enable_if_t<std::is_floating_point<Type>::value>> {
+        static constexpr ChangePolicy policy = ChangePolicy::Epsilon;
+
+        // relative to the larger magnitude, so neighbouring floats are equal at any scale and there is no absolute floor near zero
+        static constexpr Type epsilon() {
+            return std::numeric_limits<Type>::epsilon();
+        }
+    };
+
+    namespace details {
+        template<typename Type, typename Other> bool hasChanged(const Type &, const Other &, std::integral_constant<ChangePolicy, ChangePolicy::Always>) {
+            return true;
+        }
+        template<typename Type, typename Other> bool hasChanged(const Type &before, const Other &after, std::integral_constant<ChangePolicy, ChangePolicy::Inequality>) {
+            return !(before == after);
+        }
+        template<typename Type, typename Other> bool hasChanged(const Type &before, const Other &after, std::integral_constant<ChangePolicy, ChangePolicy::Epsilon>) {
+            Type next = static_cast<Type>(after);
+            return !(before == next || std::abs(before - next) <= ChangeDetection<Type>::epsilon() * std::max(std::abs(before), std::abs(next)));  // NaN is a change
+        }
+        template<typename Type, typename Other = Type> bool hasChanged(const Type &before, const Other &after) {
+            return hasChanged(before, after, std::integral_constant<ChangePolicy, ChangeDetection<Type>::policy>());
+        }
+    }
+
     namespace details {
+        // Type-erased callable like std::function, with the callable stored in a fixed buffer.
+        // Lambdas capturing more than DATAHUB_HANDLER_CAPACITY bytes do not compile.
+        template<typename> class InlineDelegate;
+        template<typename... Args> class InlineDelegate<void(Args...)> final {
+        public:
+            template<typename L, typename Callable = std::decay_t<L>, typename = std::enable_if_t<!std::is_same<Callable, InlineDelegate>::value>> InlineDelegate(L &&lambda) {
+                static_assert(sizeof(Callable) <= DATAHUB_HANDLER_CAPACITY, "Event handler captures too much: capture by reference or raise DATAHUB_HANDLER_CAPACITY");
+                static_assert(alignof(Callable) <= alignof(std::max_align_t), "Event handler capture is over-aligned");
+                static_assert(std::is_nothrow_move_constructible<Callable>::value, "Event handler capture must be nothrow movable");
+
+                new (_storage) Callable(std::forward<L>(lambda));
+                _invoke = [](void *storage, Args... args) {
+                    (*static_cast<Callable *>(storage))(std::forward<Args>(args)...);
+                };
+                _relocate = [](void *target, void *source) {
+                    if (target) {
+                        new (target) Callable(std::move(*static_cast<Callable *>(source)));
+                    }
+                    static_cast<Callable *>(source)->~Callable();
+                };
+            }
+            // moved-from delegate holds no callable, moving it gives another empty one
+            InlineDelegate(InlineDelegate &&other) noexcept : _invoke(other._invoke), _relocate(other._relocate) {
+                if (_invoke) {
+                    _relocate(_storage, other._storage);
+                    other._invoke = nullptr;
+                }
+            }
+            InlineDelegate &operator =(InlineDelegate &&other) noexcept {
+                if (this != &other) {
+                    _reset();
+                    _invoke = other._invoke;
+                    _relocate = other._relocate;
+
+                    if (_invoke) {
+                        _relocate(_storage, other._storage);
+                        other._invoke = nullptr;
+                    }
+                }
+                return *this;
+            }
+            InlineDelegate(const InlineDelegate &) = delete;
+            InlineDelegate &operator =(const InlineDelegate &) = delete;
+            ~InlineDelegate() {
+                _reset();
+            }
+
+            template <typename... CallArgs> void operator()(CallArgs&&... args) {
+                _invoke(_storage, std::forward<CallArgs>(args)...);
+            }
+
+        private:
+            alignas(std::max_align_t) unsigned char _storage[DATAHUB_HANDLER_CAPACITY];
+            void (*_invoke)(void *, Args...) = nullptr;
+            void (*_relocate)(void *, void *) = nullptr;  // moves the callable from source to target (if any) and destroys the source
+
+            void _reset() {
+                if (_invoke) {
+                    _relocate(nullptr, _storage);
+                    _invoke = nullptr;
+                }
+            }
+        };
+
+        // Generation-checked tokens of elements in a dense array. Token = generation << SLOT_BITS | slot, slot of a live
+        // element keeps its dense index, free slot keeps the next free one. Generation 0 is never used, so no token is null.
+        // 64-bit tokens split 32/32, 32-bit ones give 20 bits to slots (about a million live elements) and 12 to generations.
+        // Owner keeps the elements itself: insert() pairs with appending one, erase() with moving the last one into the index returned.
+        class SlotTable final {
+        public:
+            static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+            std::size_t size() const {
+                return _owners.size();
+            }
+
+            void reserve(std::size_t capacity) {
+                _owners.reserve(capacity);
+                _slots.reserve(capacity);
+            }
+
+            // token for new element at dense index size()
+            std::uintptr_t insert() {
+                std::uint32_t slot;
+
+                if (_freeSlot != NONE) {
+                    slot = _freeSlot;
+                    _freeSlot = _slots[slot].index;
+                }
+                else {
+                    slot = static_cast<std::uint32_t>(_slots.size());
+                    _slots.push_back(Slot{1, 0});
+                }
+
+                assert(slot <= SLOT_MASK);
+
+                _slots[slot].index = static_cast<std::uint32_t>(_owners.size());
+                _owners.push_back(slot);
+                return _slots[slot].generation << SLOT_BITS | slot;
+            }
+
+            // dense index of element or NONE for stale and unknown tokens
+            std::uint32_t find(std::uintptr_t token) const {
+                std::uintptr_t slot = token & SLOT_MASK;
+                return slot < _slots.size() && _slots[slot].generation == (token >> SLOT_BITS) ? _slots[slot].index : NONE;
+            }
+
+            std::uintptr_t token(std::size_t index) const {
+                return _slots[_owners[index]].generation << SLOT_BITS | _owners[index];
+            }
+
+            // all tokens become stale
+            void clear() {
+                for (std::uint32_t slot : _owners) {
+                    _release(slot);
+                }
+
+                _owners.clear();
+            }
+
+            // Returns dense index of erased element (NONE for stale tokens), the last element is expected to move there
+            std::uint32_t erase(std::uintptr_t token) {
+                std::uint32_t index = find(token);
+
+                if (index != NONE) {
+                    std::uint32_t slot = static_cast<std::uint32_t>(token & SLOT_MASK);
+
+                    _owners[index] = _owners.back();
+                    _slots[_owners[index]].index = index;
+                    _owners.pop_back();
+                    _release(slot);
+                }
+
+                return index;
+            }
+
+        private:
+            struct Slot {
+                std::uintptr_t generation;
+                std::uint32_t index;
+            };
+
+            static constexpr unsigned SLOT_BITS = sizeof(std::uintptr_t) >= 8 ? 32 : 20;
+            static constexpr std::uintptr_t SLOT_MASK = (std::uintptr_t(1) << SLOT_BITS) - 1;
+            static constexpr std::uintptr_t GENERATION_MASK = (std::uintptr_t(1) << (sizeof(std::uintptr_t) * 8 - SLOT_BITS)) - 1;
+
+            std::vector<std::uint32_t> _owners;  // slot of every element
+            std::vector<Slot> _slots;
+            std::uint32_t _freeSlot = NONE;
+
+            void _release(std::uint32_t slot) {
+                _slots[slot].generation = (_slots[slot].generation + 1) & GENERATION_MASK;
+                _slots[slot].generation += _slots[slot].generation == 0 ? 1 : 0;
+                _slots[slot].index = _freeSlot;
+                _freeSlot = slot;
+            }
+        };
+
         template<typename> class EventHandler final : details::MovableBase {};
         template<typename... Args> class EventHandler<void(Args...)> final : details::MovableBase {
             template<typename> friend class details::ObservableArray;
             template<typename, typename> friend class details::ObservableValue;
 
         public:
+            // Handlers added while calling are called from the next call on
             template<typename L, void(L::*)(Args...) const = &L::operator()> EventToken operator+=(L &&lambda) {
-                EventToken token = reinterpret_cast<EventToken>(_handlers.size());
-                return _handlers.emplace_back(_handlers.size(), std::move(lambda)), token;
+                if (_calling) {
+                    _additions.emplace_back(std::move(lambda));
+                }
+                else {
+                    _handlers.emplace_back(std::move(lambda));
+                }
+
+                return reinterpret_cast<EventToken>(_slots.insert());
             }
+            // Tokens of removed handlers are ignored, even after their slot is reused. Handlers removed while calling are not called
+            // anymore, but stay in place until the outermost call ends, so the running one is not destroyed or moved.
             void operator-=(EventToken id) {
-                _handlers.erase(std::remove_if(std::begin(_handlers), std::end(_handlers), [id](const auto &item) {
-                    return item.first == reinterpret_cast<std::size_t>(id);
-                }), std::end(_handlers));
+                std::uintptr_t token = reinterpret_cast<std::uintptr_t>(id);
+
+                if (_calling == 0) {
+                    _erase(token);
+                }
+                else if (_slots.find(token) != SlotTable::NONE && std::find(_removals.begin(), _removals.end(), token) == _removals.end()) {
+                    _removals.push_back(token);
+                }
             }
             template <typename... CallArgs> void call(CallArgs&&... args) {
-                for (const auto &handler : _handlers) {
-                    handler.second(std::forward<CallArgs>(args)...);
+                std::size_t count = _handlers.size();
+                _calling++;
+
+                for (std::size_t i = 0; i < count; i++) {
+                    if (_removals.empty() || std::find(_removals.begin(), _removals.end(), _slots.token(i)) == _removals.end()) {
+                        _handlers[i](std::forward<CallArgs>(args)...);
+                    }
+                }
+
+                if (--_calling == 0 && (_additions.size() || _removals.size())) {
+                    _applyChanges();
                 }
             }
 
         private:
-            std::vector<std::pair<std::size_t, std::function<void(Args...)>>> _handlers;
+            std::vector<InlineDelegate<void(Args...)>> _handlers;
+            std::vector<InlineDelegate<void(Args...)>> _additions;  // added while calling, their dense indices follow _handlers
+            std::vector<std::uintptr_t> _removals;                  // tokens removed while calling
+            std::size_t _calling = 0;
+            SlotTable _slots;
+
+            void _erase(std::uintptr_t token) {
+                std::uint32_t index = _slots.erase(token);
+
+                // the last handler takes the place of the removed one, so calls keep going over a dense array
+                if (index != SlotTable::NONE) {
+                    _handlers[index] = std::move(_handlers.back());
+                    _handlers.pop_back();
+                }
+            }
+
+            void _applyChanges() {
+                for (InlineDelegate<void(Args...)> &handler : _additions) {
+                    _handlers.push_back(std::move(handler));
+                }
+                for (std::uintptr_t token : _removals) {
+                    _erase(token);
+                }
+
+                _additions.clear();
+                _removals.clear();
+            }
         };
 
+        // Elements are kept contiguous in a vector and iterated in its order. Removal moves the last element into the hole,
+        // so element references are valid until the next add or remove, tokens stay valid until their element is removed.
+        // Range operations fire one range event with all tokens after (added) or before (removing) the per-element events,
+        // nothing if no element is added or removed.
         template<typename Derived> class ObservableArray final : MovableBase {
         public:
             EventHandler<void(ArrayToken, Derived &)> onArrayElementAdded;
             EventHandler<void(ArrayToken)> onArrayElementRemoving;
+            EventHandler<void(const ArrayToken *, std::size_t)> onArrayRangeAdded;
+            EventHandler<void(const ArrayToken *, std::size_t)> onArrayRangeRemoving;
             
             template<typename L, void(L::*)(Derived &) const = &L::operator()> ArrayToken add(L &&initializer) {
-                ArrayToken result = reinterpret_cast<ArrayToken>(_uniqueid++);
-                typename std::unordered_map<ArrayToken, Derived>::iterator position = _data.emplace(result, Derived{}).first;
-                initializer(position->second);
-                onArrayElementAdded.call(result, position->second);
+                _data.emplace_back();
+                ArrayToken result = reinterpret_cast<ArrayToken>(_slots.insert());
+                initializer(_data.back());
+                onArrayElementAdded.call(result, _data.back());
                 return result;
             }
             
+            // Adds 'count' elements, initializer gets each one with its index in the range. 'tokens' (may be null) receives their tokens.
+            template<typename L, void(L::*)(Derived &, std::size_t) const = &L::operator()> void addRange(std::size_t count, L &&initializer, ArrayToken *tokens = nullptr) {
+                std::size_t first = _data.size();
+                std::vector<ArrayToken> added = _takeRangeBuffer();
+
+                if (_data.capacity() < first + count) {
+                    std::size_t capacity = std::max(first + count, 2 * _data.capacity());
+                    _data.reserve(capacity);
+                    _slots.reserve(capacity);
+                }
+
+                added.resize(count);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    _data.emplace_back();
+                    added[i] = reinterpret_cast<ArrayToken>(_slots.insert());
+                    initializer(_data.back(), i);
+                }
+                for (std::size_t i = 0; i < count; i++) {
+                    ArrayToken id = added[i];
+                    Derived *element = find(id);
+
+                    if (element) {
+                        onArrayElementAdded.call(id, *element);
+                    }
+                }
+
+                if (count) {
+                    onArrayRangeAdded.call(added.data(), count);
+                }
+
+                if (tokens) {
+                    std::copy(added.begin(), added.end(), tokens);
+                }
+
+                _returnRangeBuffer(std::move(added));
+            }
+
+            // Removed and unknown tokens are ignored, so are repeated ones. Range event lists tokens in unspecified order.
+            void removeRange(const ArrayToken *ids, std::size_t count) {
+                std::vector<ArrayToken> removing = _takeRangeBuffer();
+
+                for (std::size_t i = 0; i < count; i++) {
+                    if (_slots.find(reinterpret_cast<std::uintptr_t>(ids[i])) != SlotTable::NONE) {
+                        removing.push_back(ids[i]);
+                    }
+                }
+
+                std::sort(removing.begin(), removing.end());
+                removing.erase(std::unique(removing.begin(), removing.end()), removing.end());
+                _fireRangeRemoving(removing);
+
+                for (ArrayToken id : removing) {
+                    _erase(id);
+                }
+
+                _returnRangeBuffer(std::move(removing));
+            }
+
+            void clear() {
+                std::vector<ArrayToken> removing = _takeRangeBuffer();
+                removing.resize(_data.size());
+
+                for (std::size_t i = 0; i < _data.size(); i++) {
+                    removing[i] = reinterpret_cast<ArrayToken>(_slots.token(i));
+                }
+
+                _fireRangeRemoving(removing);
+
+                // elements added by handlers meanwhile stay, reverse order only pops the back when nothing changed
+                for (std::size_t i = removing.size(); i > 0; i--) {
+                    _erase(removing[i - 1]);
+                }
+
+                _returnRangeBuffer(std::move(removing));
+            }
+
+            // Removed and unknown tokens are ignored
             void remove(ArrayToken id) {
-                onArrayElementRemoving.call(id);
-                _data.erase(id);
+                if (_slots.find(reinterpret_cast<std::uintptr_t>(id)) != SlotTable::NONE) {
+                    onArrayElementRemoving.call(id);
+                    _erase(id);
+                }
             }
             
+            // 'id' must be a token of an element in the array
             Derived &operator[](ArrayToken id) {
-                return _data[id];
+                std::uint32_t index = _slots.find(reinterpret_cast<std::uintptr_t>(id));
+                assert(index != SlotTable::NONE);
+                return _data[index];
+            }
+
+            // nullptr for removed and unknown tokens
+            Derived *find(ArrayToken id) {
+                std::uint32_t index = _slots.find(reinterpret_cast<std::uintptr_t>(id));
+                return index != SlotTable::NONE ? &_data[index] : nullptr;
+            }
+
+            std::size_t size() const {
+                return _data.size();
             }
 
             template<typename L, void(L::*)(ArrayToken, Derived &) const = &L::operator()> void foreach(L &&functor) {
-                for (auto it = _data.begin(); it != _data.end(); ++it) {
-                    functor(it->first, it->second);
+                for (std::size_t i = 0; i < _data.size(); i++) {
+                    functor(reinterpret_cast<ArrayToken>(_slots.token(i)), _data[i]);
                 }
             }
 
         private:
-            std::unordered_map<ArrayToken, Derived> _data;
-            std::size_t _uniqueid = 0x1;
+            std::vector<Derived> _data;
+            std::vector<ArrayToken> _spareTokens;  // token buffer of a finished range operation, kept for its capacity
+            SlotTable _slots;
+
+            // Every range operation owns its token buffer, so nested ones started by handlers don't overwrite it
+            std::vector<ArrayToken> _takeRangeBuffer() {
+                std::vector<ArrayToken> result;
+                result.swap(_spareTokens);
+                result.clear();
+                return result;
+            }
+
+            void _returnRangeBuffer(std::vector<ArrayToken> &&buffer) {
+                if (buffer.capacity() > _spareTokens.capacity()) {
+                    _spareTokens = std::move(buffer);
+                }
+            }
+
+            // handlers may have changed the array, so the token is checked again
+            void _erase(ArrayToken id) {
+                std::uint32_t index = _slots.erase(reinterpret_cast<std::uintptr_t>(id));
+
+                if (index != SlotTable::NONE) {
+                    if (index + 1 != _data.size()) {
+                        _data[index].~Derived();
+                        new (&_data[index]) Derived(std::move(_data.back()));
+                    }
+
+                    _data.pop_back();
+                }
+            }
+
+            void _fireRangeRemoving(const std::vector<ArrayToken> &removing) {
+                if (removing.size()) {
+                    onArrayRangeRemoving.call(removing.data(), removing.size());
+                }
+
+                for (ArrayToken id : removing) {
+                    onArrayElementRemoving.call(id);
+                }
+            }
         };
 
+        // Notification delaying for transactions. Values written while a transaction is open (or in frame mode) are recorded
+        // once in 'entries' and notified with their final value at flush, unless it equals the value handlers saw last.
+        // State is per thread: transactions and frame mode of one thread don't delay writes made on another.
+        class Deferrable;
+
+        struct TransactionState {
+            struct Entry {
+                Deferrable *target;  // null if the value was destroyed before flush
+                void (*notify)(Deferrable *);
+            };
+
+            std::vector<Entry> entries;
+            std::size_t depth = 0;
+            bool frameMode = false;
+        };
+
+        inline TransactionState &transactionState() {
+            thread_local static TransactionState state;
+            return state;
+        }
+
+        class Deferrable {
+        protected:
+            Deferrable() = default;
+            Deferrable(Deferrable &&other) : _entry(other._entry) {
+                if (_entry != NONE) {
+                    transactionState().entries[_entry].target = this;
+                    other._entry = NONE;
+                }
+            }
+            Deferrable(const Deferrable &) = delete;
+            Deferrable &operator =(Deferrable &&) = delete;
+            Deferrable &operator =(const Deferrable &) = delete;
+            ~Deferrable() {
+                if (_entry != NONE) {
+                    transactionState().entries[_entry].target = nullptr;
+                }
+            }
+
+            // True if a change now is deferred and is the first one since the last notification,
+            // so the value handlers saw last has to be kept for comparison at flush
+            bool _startsDeferral() const {
+                return _entry == NONE && _deferring();
+            }
+
+            // False if notification must be sent right now, otherwise 'notify' is called for this value at flush
+            bool _defer(void (*notify)(Deferrable *)) {
+                TransactionState &state = transactionState();
+
+                if (_deferring() == false) {
+                    return false;
+                }
+                if (_entry == NONE) {
+                    _entry = state.entries.size();
+                    state.entries.push_back({this, notify});
+                }
+
+                return true;
+            }
+
+        private:
+            friend void flushNotifications();
+            static constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+            std::size_t _entry = NONE;
+
+            static bool _deferring() {
+                const TransactionState &state = transactionState();
+                return state.depth != 0 || state.frameMode;
+            }
+        };
+
+        // Handlers run as inside of a transaction: values they write, also in transactions of their own,
+        // are appended and notified later in the same flush instead of starting a nested one
+        inline void flushNotifications() {
+            TransactionState &state = transactionState();
+            state.depth++;
+
+            for (std::size_t i = 0; i < state.entries.size(); i++) {
+                TransactionState::Entry entry = state.entries[i];
+
+                if (entry.target) {
+                    entry.target->_entry = Deferrable::NONE;
+                    entry.notify(entry.target);
+                }
+            }
+
+            state.entries.clear();
+            state.depth--;
+        }
+
         template<typename Type, typename = void> class ObservableValue : MovableBase {};
-        template<typename Type> class ObservableValue<Type, std::enable_if_t<std::is_class<Type>::value || std::is_pointer<Type>::value>> : MovableBase {
+        template<typename Type> class ObservableValue<Type, std::enable_if_t<std::is_class<Type>::value || std::is_pointer<Type>::value>> : MovableBase, Deferrable {
         public:
             EventHandler<void(const Type &)> onValueChanged;
 
@@ -104,8 +593,22 @@ namespace datahub {
                 _data = std::forward<AssignType>(value);
             }
             template<typename AssignType> void operator =(AssignType&& value) {
-                _data = std::forward<AssignType>(value);
-                onValueChanged.call(_data);
+                if constexpr (ChangeDetection<Type>::policy == ChangePolicy::Always) {
+                    _data = std::forward<AssignType>(value);
+                    _changed();
+                }
+                else {
+                    Type next (std::forward<AssignType>(value));
+
+                    if (hasChanged(_data, next)) {
+                        if (_startsDeferral()) {
+                            _notified = _data;
+                        }
+
+                        _data = std::move(next);
+                        _changed();
+                    }
+                }
             }
             operator Type &() {
                 return _data;
@@ -119,8 +622,22 @@ namespace datahub {
 
         private:
             Type _data;
+            Type _notified;  // value handlers saw last, kept from the first deferred change until flush
+
+            void _changed() {
+                if (_defer(_notify) == false) {
+                    onValueChanged.call(_data);
+                }
+            }
+            static void _notify(Deferrable *self) {
+                ObservableValue *value = static_cast<ObservableValue *>(self);
+
+                if (hasChanged(value->_notified, value->_data)) {
+                    value->onValueChanged.call(value->_data);
+                }
+            }
         };
-        template<typename Type> class ObservableValue<Type, std::enable_if_t<std::is_arithmetic<Type>::value>> : MovableBase {
+        template<typename Type> class ObservableValue<Type, std::enable_if_t<std::is_arithmetic<Type>::value>> : MovableBase, Deferrable {
         public:
             EventHandler<void(Type)> onValueChanged;
         
@@ -128,12 +645,10 @@ namespace datahub {
                 _data = static_cast<long double>(value);
             }
             template<typename AssignType> auto operator =(AssignType value) -> typename std::enable_if<std::is_arithmetic<AssignType>::value, void>::type {
-                _data = static_cast<long double>(value);
-                onValueChanged.call(static_cast<Type>(_data));
+                _assign(static_cast<long double>(value));
             }
             void operator =(const char *string) {
-                _data = static_cast<long double>(std::strtold(string, nullptr));
-                onValueChanged.call(static_cast<Type>(_data));
+                _assign(static_cast<long double>(std::strtold(string, nullptr)));
             }
             operator const char *() const {
                 thread_local static char buffer[32];
@@ -152,8 +667,34 @@ namespace datahub {
 
         private:
             long double _data;
+            long double _notified;  // value handlers saw last, kept from the first deferred change until flush
+
+            // compared as seen by handlers, unchanged writes are dropped so the value can't drift without notification
+            void _assign(long double value) {
+                if (hasChanged(static_cast<Type>(_data), static_cast<Type>(value))) {
+                    if (_startsDeferral()) {
+                        _notified = _data;
+                    }
+
+                    _data = value;
+                    _changed();
+                }
+            }
+
+            void _changed() {
+                if (_defer(_notify) == false) {
+                    onValueChanged.call(static_cast<Type>(_data));
+                }
+            }
+            static void _notify(Deferrable *self) {
+                ObservableValue *value = static_cast<ObservableValue *>(self);
+
+                if (hasChanged(static_cast<Type>(value->_notified), static_cast<Type>(value->_data))) {
+                    value->onValueChanged.call(static_cast<Type>(value->_data));
+                }
+            }
         };
-        template<std::size_t N> class ObservableValue<const char(&)[N]> : MovableBase {
+        template<std::size_t N> class ObservableValue<const char(&)[N]> : MovableBase, Deferrable {
         public:
             EventHandler<void(const char *)> onValueChanged;
             ObservableValue(const char *string) : _data(string) {}
@@ -161,16 +702,13 @@ namespace datahub {
             template<typename AssignType> auto operator =(AssignType value) -> typename std::enable_if<std::is_arithmetic<AssignType>::value, void>::type {
                 thread_local static char buffer[32];
                 ::snprintf(buffer, 32, "%g", static_cast<double>(value));
-                _data = buffer;
-                onValueChanged.call(_data.c_str());
+                _assign(buffer);
             }
             void operator =(const char *string) {
-                _data = string;
-                onValueChanged.call(_data.c_str());
+                _assign(string);
             }
             void operator =(bool value) {
-                _data = value ? "true" : "false";
-                onValueChanged.call(_data.c_str());
+                _assign(value ? "true" : "false");
             }
             operator const char *() const {
                 return _data.c_str();
@@ -197,17 +735,42 @@ namespace datahub {
 
         private:
             std::string _data;
+            std::string _notified;  // value handlers saw last, kept from the first deferred change until flush
+
+            void _assign(const char *string) {
+                if (hasChanged(_data, string)) {
+                    if (_startsDeferral()) {
+                        _notified = _data;
+                    }
+
+                    _data = string;
+                    _changed();
+                }
+            }
+
+            void _changed() {
+                if (_defer(_notify) == false) {
+                    onValueChanged.call(_data.c_str());
+                }
+            }
+            static void _notify(Deferrable *self) {
+                ObservableValue *value = static_cast<ObservableValue *>(self);
+
+                if (hasChanged(value->_notified, value->_data)) {
+                    value->onValueChanged.call(value->_data.c_str());
+                }
+            }
         };
-        template<> class ObservableValue<bool> : MovableBase {
+        template<> class ObservableValue<bool> : MovableBase, Deferrable {
         public:
             EventHandler<void(bool)> onValueChanged;
             ObservableValue(bool value) : _data(value) {}
 
             void operator =(bool value) {
-                _data = value;
+                _assign(value);
             }
             void operator =(const char *string) {
-                _data = ::strcasecmp(string, "true") == 0;
+                _assign(::strcasecmp(string, "true") == 0);
             }
             operator const char *() const {
                 return _data ? "true" : "false";
@@ -218,9 +781,76 @@ namespace datahub {
 
         private:
             bool _data;
+            bool _notified;  // value handlers saw last, kept from the first deferred change until flush
+
+            void _assign(bool value) {
+                if (hasChanged(_data, value)) {
+                    if (_startsDeferral()) {
+                        _notified = _data;
+                    }
+
+                    _data = value;
+                    _changed();
+                }
+            }
+            void _changed() {
+                if (_defer(_notify) == false) {
+                    onValueChanged.call(_data);
+                }
+            }
+            static void _notify(Deferrable *self) {
+                ObservableValue *value = static_cast<ObservableValue *>(self);
+
+                if (hasChanged(value->_notified, value->_data)) {
+                    value->onValueChanged.call(value->_data);
+                }
+            }
         };
     }
 
+    // Value notifications inside of a transaction are delayed until the outermost one ends, then every changed value
+    // is notified once with its final value. Values set back to what handlers saw last are not notified. Transactions nest.
+    //
+    //   {
+    //       datahub::Transaction transaction;
+    //       scope.width = 100;
+    //       scope.width = 200;
+    //   }   // onValueChanged(200) here
+    class Transaction final {
+    public:
+        Transaction() {
+            details::transactionState().depth++;
+        }
+        ~Transaction() {
+            details::TransactionState &state = details::transactionState();
+
+            if (--state.depth == 0 && state.frameMode == false) {
+                details::flushNotifications();
+            }
+        }
+
+        Transaction(const Transaction &) = delete;
+        Transaction &operator =(const Transaction &) = delete;
+    };
+
+    // Frame mode delays all value notifications of the calling thread until flush(), which is expected to be called once per frame.
+    // Turning it off sends delayed notifications, if no transaction is open.
+    inline void setFrameMode(bool enabled) {
+        details::TransactionState &state = details::transactionState();
+        state.frameMode = enabled;
+
+        if (enabled == false && state.depth == 0) {
+            details::flushNotifications();
+        }
+    }
+
+    // Sends delayed notifications, if no transaction is open
+    inline void flush() {
+        if (details::transactionState().depth == 0) {
+            details::flushNotifications();
+        }
+    }
+
     // unittest scope
     // -----------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -229,6 +859,7 @@ namespace datahub {
         datahubvalue(teststring, "unittest")
         datahubvalue(testvalue, 99)
         datahubvalue(testbool, true)
+        datahubvalue(testfloat, 0.5f)
         
         datahubarray(ArrayElement, testarray, {
             datahubvalue(teststring, "title")
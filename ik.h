@@ -0,0 +1,148 @@
+#pragma once
+
+// Inverse kinematics for joint chains stored in flat arrays, root first and end effector last.
+// Solvers move joint positions keeping bone lengths and, if orientations are given, turn every joint orientation
+// by the same world space rotation as its bone, so attached geometry follows.
+// Chains longer than IK_MAX_JOINTS joints are solved for the first IK_MAX_JOINTS of them.
+//
+//   IKOptions options;
+//   bool reached = solveFABRIK(positions, orientations, jointCount, target, options);
+//   std::size_t reachedCount = solveChains(IKMethod::CCD, positions, orientations, offsets, targets, chainCount, options);
+
+#include <vector>
+#include "common.h"
+#include "math.h"
+
+namespace math
+{
+    constexpr std::size_t IK_MAX_JOINTS = 64;
+
+    enum class IKMethod {
+        CCD,     // cyclic coordinate descent: each joint turns the rest of the chain towards the target
+        FABRIK,  // forward and backward reaching: joints are dragged along lines to the target and back to the root
+    };
+
+    struct IKOptions {
+        std::size_t iterations = 16;
+        scalar tolerance = scalar(0.001);  // distance of end effector to target to stop at
+        std::size_t threadCount = 0;       // 0 = std::thread::hardware_concurrency(), batch only
+    };
+
+    namespace imp {
+        // point at 'length' from 'from' towards 'to', keeping 'fallback' direction if they coincide
+        inline vector3f ikPlace(const vector3f &from, const vector3f &to, scalar length, const vector3f &fallback) {
+            vector3f d = to - from;
+            scalar dl = d.length();
+            return dl > std::numeric_limits<scalar>::epsilon() ? from + d * (length / dl) : from + fallback;
+        }
+    }
+
+    // 'orientations' may be null. True if the end effector ended up within tolerance of the target.
+    inline bool solveCCD(vector3f *positions, quaternion *orientations, std::size_t count, const vector3f &target, const IKOptions &options = {}) {
+        count = std::min(count, IK_MAX_JOINTS);
+
+        if (count < 2) {
+            return count == 1 && positions[0].distanceTo(target) <= options.tolerance;
+        }
+
+        vector3f &effector = positions[count - 1];
+
+        for (std::size_t iteration = 0; iteration < options.iterations && effector.distanceTo(target) > options.tolerance; iteration++) {
+            for (std::size_t i = count - 1; i-- > 0; ) {
+                const vector3f pivot = positions[i];
+                quaternion r = (effector - pivot).rotationTo(target - pivot);
+
+                for (std::size_t k = i + 1; k < count; k++) {
+                    positions[k] = pivot + (positions[k] - pivot).transformed(r);
+                }
+                if (orientations) {
+                    for (std::size_t k = i; k < count; k++) {
+                        orientations[k] = (orientations[k] * r).normalized();
+                    }
+                }
+            }
+        }
+
+        return effector.distanceTo(target) <= options.tolerance;
+    }
+
+    // Unreachable targets straighten the chain towards them
+    inline bool solveFABRIK(vector3f *positions, quaternion *orientations, std::size_t count, const vector3f &target, const IKOptions &options = {}) {
+        count = std::min(count, IK_MAX_JOINTS);
+
+        if (count < 2) {
+            return count == 1 && positions[0].distanceTo(target) <= options.tolerance;
+        }
+
+        scalar lengths[IK_MAX_JOINTS];
+        vector3f bones[IK_MAX_JOINTS];  // initial bone vectors, they give the fallback directions and the final joint rotations
+        scalar total = 0;
+
+        for (std::size_t i = 0; i + 1 < count; i++) {
+            bones[i] = positions[i + 1] - positions[i];
+            lengths[i] = bones[i].length();
+            total += lengths[i];
+        }
+
+        const vector3f root = positions[0];
+        vector3f &effector = positions[count - 1];
+
+        if (root.distanceTo(target) >= total) {
+            for (std::size_t i = 0; i + 1 < count; i++) {
+                positions[i + 1] = imp::ikPlace(positions[i], target, lengths[i], bones[i]);
+            }
+        }
+        else {
+            for (std::size_t iteration = 0; iteration < options.iterations && effector.distanceTo(target) > options.tolerance; iteration++) {
+                effector = target;
+
+                for (std::size_t i = count - 1; i-- > 0; ) {
+                    positions[i] = imp::ikPlace(positions[i + 1], positions[i], lengths[i], -bones[i]);
+                }
+
+                positions[0] = root;
+
+                for (std::size_t i = 0; i + 1 < count; i++) {
+                    positions[i + 1] = imp::ikPlace(positions[i], positions[i + 1], lengths[i], bones[i]);
+                }
+            }
+        }
+
+        if (orientations) {
+            quaternion r = quaternion::identity();
+
+            for (std::size_t i = 0; i < count; i++) {
+                // the end effector has no bone of its own and follows the last one
+                r = i + 1 < count ? bones[i].rotationTo(positions[i + 1] - positions[i]) : r;
+                orientations[i] = (orientations[i] * r).normalized();
+            }
+        }
+
+        return effector.distanceTo(target) <= options.tolerance;
+    }
+
+    // Solves independent chains on worker threads. Chain c is made of joints [offsets[c], offsets[c + 1]) of 'positions' and 'orientations'
+    // ('orientations' may be null) and is pulled to targets[c]. Returns number of chains that reached their targets.
+    inline std::size_t solveChains(IKMethod method, vector3f *positions, quaternion *orientations, const std::size_t *offsets, const vector3f *targets, std::size_t chainCount, const IKOptions &options = {}) {
+        std::size_t threadCount = options.threadCount ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::size_t> reached (threadCount);
+
+        utility::parallelFor(chainCount, threadCount, 8, [&](std::size_t begin, std::size_t end, std::size_t slot) {
+            for (std::size_t c = begin; c < end; c++) {
+                vector3f *chainPositions = positions + offsets[c];
+                quaternion *chainOrientations = orientations ? orientations + offsets[c] : nullptr;
+                std::size_t count = offsets[c + 1] - offsets[c];
+                bool result = method == IKMethod::CCD ? solveCCD(chainPositions, chainOrientations, count, targets[c], options) : solveFABRIK(chainPositions, chainOrientations, count, targets[c], options);
+                reached[slot] += result ? 1 : 0;
+            }
+        });
+
+        std::size_t result = 0;
+
+        for (std::size_t r : reached) {
+            result += r;
+        }
+
+        return result;
+    }
+}
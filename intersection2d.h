@@ -0,0 +1,215 @@
+#pragma once
+
+// Batch 2D queries over SoA arrays: segment-segment intersection, point in convex / any polygon, segment clipping by bound2f.
+// Kernels are written once over scalar and lane types; with SSE2 8 queries are answered per step and the tail goes through
+// the same kernel with scalars. Results are bytes of 0 / 1.
+
+#include <cstdint>
+#include "math_batch.h"
+
+namespace math
+{
+    // Segment i goes from (x0[i], y0[i]) to (x1[i], y1[i])
+    struct SegmentArrays {
+        const scalar *x0;
+        const scalar *y0;
+        const scalar *x1;
+        const scalar *y1;
+    };
+
+    namespace imp {
+        template <typename F> struct SegmentLanes {
+            F x0, y0, x1, y1;
+        };
+
+        inline SegmentLanes<scalar> loadSegment(const SegmentArrays &s, std::size_t i) {
+            return {s.x0[i], s.y0[i], s.x1[i], s.y1[i]};
+        }
+
+    #ifdef MATH_BATCH_SSE2
+        inline SegmentLanes<floatx8> loadSegments(const SegmentArrays &s, std::size_t i) {
+            return {floatx8::load(s.x0 + i), floatx8::load(s.y0 + i), floatx8::load(s.x1 + i), floatx8::load(s.y1 + i)};
+        }
+    #endif
+
+        // a(t) = b(u) for t, u in [0, 1], solved by cross products without division until the hit is known.
+        // Parallel and collinear segments do not intersect. 't' is the hit parameter along 'a'.
+        template <typename F> inline auto segmentsIntersect(const SegmentLanes<F> &a, const SegmentLanes<F> &b, F &t) -> decltype(F() < F()) {
+            F dax = a.x1 - a.x0, day = a.y1 - a.y0;
+            F dbx = b.x1 - b.x0, dby = b.y1 - b.y0;
+            F ex = b.x0 - a.x0, ey = b.y0 - a.y0;
+            F denom = dax * dby - day * dbx;
+            F tn = ex * dby - ey * dbx;
+            F un = ex * day - ey * dax;
+
+            // turn the denominator positive, so the range tests need no division
+            auto negative = denom < F(0);
+            denom = laneSelect(negative, F(0) - denom, denom);
+            tn = laneSelect(negative, F(0) - tn, tn);
+            un = laneSelect(negative, F(0) - un, un);
+
+            auto hit = laneAnd(laneAnd(F(0) < denom, laneAnd(F(0) <= tn, tn <= denom)), laneAnd(F(0) <= un, un <= denom));
+            t = tn / laneSelect(hit, denom, F(1));
+            return hit;
+        }
+
+        // Points on the boundary are inside. 'winding' is 1 for counter-clockwise polygons, -1 for clockwise ones.
+        template <typename F> inline auto insideConvex(const F &x, const F &y, const vector2f *polygon, std::size_t count, scalar winding) -> decltype(F() < F()) {
+            auto inside = F(0) <= F(0);  // all lanes true
+
+            for (std::size_t i = 0; i < count && laneAny(inside); i++) {
+                const vector2f &a = polygon[i];
+                const vector2f &b = polygon[i + 1 < count ? i + 1 : 0];
+                F ex = F((b.x - a.x) * winding), ey = F((b.y - a.y) * winding);
+                inside = laneAnd(inside, F(0) <= ex * (y - F(a.y)) - ey * (x - F(a.x)));
+            }
+
+            return inside;
+        }
+
+        // even-odd rule: a ray to +x crosses edges an odd number of times from inside
+        template <typename F> inline auto insidePolygon(const F &x, const F &y, const vector2f *polygon, std::size_t count) -> decltype(F() < F()) {
+            auto inside = F(0) < F(0);  // all lanes false
+
+            for (std::size_t i = 0; i < count; i++) {
+                const vector2f &a = polygon[i];
+                const vector2f &b = polygon[i + 1 < count ? i + 1 : 0];
+
+                // horizontal edges are never crossed (either both ends are above the ray or both are not)
+                if (a.y != b.y) {
+                    scalar slope = (b.x - a.x) / (b.y - a.y);
+                    auto spans = laneXor(y < F(a.y), y < F(b.y));
+                    auto crossing = laneAnd(spans, x < F(a.x) + (y - F(a.y)) * F(slope));
+                    inside = laneXor(inside, crossing);
+                }
+            }
+
+            return inside;
+        }
+
+        // Liang-Barsky: parameter range of the segment inside every slab of the bound
+        template <typename F> inline auto clipSegment(const SegmentLanes<F> &s, const bound2f &bound, F &t0, F &t1) -> decltype(F() < F()) {
+            const F huge = F(std::numeric_limits<scalar>::max());
+            t0 = F(0);
+            t1 = F(1);
+
+            auto slab = [&](const F &origin, const F &delta, scalar min, scalar max) {
+                auto parallel = delta == F(0);
+                F safe = laneSelect(parallel, F(1), delta);
+                F a = (F(min) - origin) / safe;
+                F b = (F(max) - origin) / safe;
+                auto within = laneAnd(F(min) <= origin, origin <= F(max));
+
+                // parallel segment is either inside the slab for any t or for none
+                F enter = laneSelect(parallel, laneSelect(within, F(0) - huge, huge), laneMin(a, b));
+                F leave = laneSelect(parallel, laneSelect(within, huge, F(0) - huge), laneMax(a, b));
+                t0 = laneMax(t0, enter);
+                t1 = laneMin(t1, leave);
+            };
+
+            slab(s.x0, s.x1 - s.x0, bound.xmin, bound.xmax);
+            slab(s.y0, s.y1 - s.y0, bound.ymin, bound.ymax);
+            return t0 <= t1;
+        }
+
+        inline scalar polygonWinding(const vector2f *polygon, std::size_t count) {
+            scalar area = 0;
+
+            for (std::size_t i = 0; i < count; i++) {
+                area += polygon[i].cross(polygon[i + 1 < count ? i + 1 : 0]);
+            }
+
+            return area < scalar(0.0) ? scalar(-1.0) : scalar(1.0);
+        }
+    }
+
+    namespace batch {
+        // hits[i] = segment a[i] intersects segment b[i], 't' (may be null) receives the hit parameter along a[i] where hits[i] is 1
+        inline void intersect(const SegmentArrays &a, const SegmentArrays &b, std::size_t count, std::uint8_t *hits, scalar *t = nullptr) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            for (; i + 8 <= count; i += 8) {
+                imp::floatx8 param;
+                imp::floatx8 hit = imp::segmentsIntersect(imp::loadSegments(a, i), imp::loadSegments(b, i), param);
+                imp::laneStore(hit, hits + i);
+
+                if (t) {
+                    param.store(t + i);
+                }
+            }
+        #endif
+
+            for (; i < count; i++) {
+                scalar param;
+                imp::laneStore(imp::segmentsIntersect(imp::loadSegment(a, i), imp::loadSegment(b, i), param), hits + i);
+
+                if (t) {
+                    t[i] = param;
+                }
+            }
+        }
+
+        // result[i] = point (x[i], y[i]) is inside or on the boundary of convex polygon of either winding
+        inline void insideConvex(const scalar *x, const scalar *y, std::size_t count, const vector2f *polygon, std::size_t polygonCount, std::uint8_t *result) {
+            scalar winding = imp::polygonWinding(polygon, polygonCount);
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            for (; i + 8 <= count; i += 8) {
+                imp::laneStore(imp::insideConvex(imp::floatx8::load(x + i), imp::floatx8::load(y + i), polygon, polygonCount, winding), result + i);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                imp::laneStore(imp::insideConvex(x[i], y[i], polygon, polygonCount, winding), result + i);
+            }
+        }
+
+        // result[i] = point (x[i], y[i]) is inside of any simple or self-intersecting polygon by the even-odd rule
+        inline void insidePolygon(const scalar *x, const scalar *y, std::size_t count, const vector2f *polygon, std::size_t polygonCount, std::uint8_t *result) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            for (; i + 8 <= count; i += 8) {
+                imp::laneStore(imp::insidePolygon(imp::floatx8::load(x + i), imp::floatx8::load(y + i), polygon, polygonCount), result + i);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                imp::laneStore(imp::insidePolygon(x[i], y[i], polygon, polygonCount), result + i);
+            }
+        }
+
+        // hits[i] = part of segment i lies in 'bound', that part is [t0[i], t1[i]] of the segment parameter (both may be null)
+        inline void clip(const SegmentArrays &segments, std::size_t count, const bound2f &bound, std::uint8_t *hits, scalar *t0 = nullptr, scalar *t1 = nullptr) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            for (; i + 8 <= count; i += 8) {
+                imp::floatx8 enter, leave;
+                imp::laneStore(imp::clipSegment(imp::loadSegments(segments, i), bound, enter, leave), hits + i);
+
+                if (t0) {
+                    enter.store(t0 + i);
+                }
+                if (t1) {
+                    leave.store(t1 + i);
+                }
+            }
+        #endif
+
+            for (; i < count; i++) {
+                scalar enter, leave;
+                imp::laneStore(imp::clipSegment(imp::loadSegment(segments, i), bound, enter, leave), hits + i);
+
+                if (t0) {
+                    t0[i] = enter;
+                }
+                if (t1) {
+                    t1[i] = leave;
+                }
+            }
+        }
+    }
+}
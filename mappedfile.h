@@ -0,0 +1,208 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "common.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace utility {
+    // Read-only mapped range of a file. Owns the mapping and unmaps it on destruction.
+    class MappedView {
+        friend class MappedFile;
+
+    public:
+        MappedView() = default;
+        MappedView(MappedView &&other) {
+            *this = std::move(other);
+        }
+        ~MappedView() {
+            reset();
+        }
+
+        MappedView &operator =(MappedView &&other) {
+            if (this != &other) {
+                reset();
+                std::swap(_base, other._base);
+                std::swap(_baseSize, other._baseSize);
+                std::swap(_shift, other._shift);
+                std::swap(_size, other._size);
+            }
+            return *this;
+        }
+
+        explicit operator bool() const {
+            return _base != nullptr;
+        }
+
+        const std::uint8_t *data() const {
+            return static_cast<const std::uint8_t *>(_base) + _shift;
+        }
+
+        std::size_t size() const {
+            return _size;
+        }
+
+        // asks the OS to start reading the range in background
+        void prefetch() const {
+            if (_base) {
+            #ifdef _WIN32
+                WIN32_MEMORY_RANGE_ENTRY range {_base, _baseSize};
+                ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+            #else
+                ::madvise(_base, _baseSize, MADV_WILLNEED);
+            #endif
+            }
+        }
+
+        void reset() {
+            if (_base) {
+            #ifdef _WIN32
+                ::UnmapViewOfFile(_base);
+            #else
+                ::munmap(_base, _baseSize);
+            #endif
+            }
+
+            _base = nullptr;
+            _baseSize = _shift = _size = 0;
+        }
+
+    private:
+        void *_base = nullptr;
+        std::size_t _baseSize = 0;
+        std::size_t _shift = 0;
+        std::size_t _size = 0;
+
+        MappedView(const MappedView &) = delete;
+        MappedView &operator =(const MappedView &) = delete;
+    };
+
+    // Read-only file that can be mapped as a whole or window by window
+    class MappedFile : NonCopyable {
+    public:
+        MappedFile() = default;
+        ~MappedFile() {
+            close();
+        }
+
+        bool open(const char *path) {
+            close();
+
+        #ifdef _WIN32
+            LARGE_INTEGER size;
+            _file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+            if (_file != INVALID_HANDLE_VALUE && ::GetFileSizeEx(_file, &size)) {
+                _size = std::uint64_t(size.QuadPart);
+                _mapping = _size ? ::CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+
+                if (_mapping || _size == 0) {
+                    return true;
+                }
+            }
+        #else
+            struct stat info;
+            _file = ::open(path, O_RDONLY);
+
+            if (_file >= 0 && ::fstat(_file, &info) == 0) {
+                _size = std::uint64_t(info.st_size);
+                return true;
+            }
+        #endif
+
+            close();
+            return false;
+        }
+
+        void close() {
+        #ifdef _WIN32
+            if (_mapping) {
+                ::CloseHandle(_mapping);
+            }
+            if (_file != INVALID_HANDLE_VALUE) {
+                ::CloseHandle(_file);
+            }
+
+            _mapping = nullptr;
+            _file = INVALID_HANDLE_VALUE;
+        #else
+            if (_file >= 0) {
+                ::close(_file);
+            }
+
+            _file = -1;
+        #endif
+            _size = 0;
+        }
+
+        bool isOpen() const {
+        #ifdef _WIN32
+            return _file != INVALID_HANDLE_VALUE;
+        #else
+            return _file >= 0;
+        #endif
+        }
+
+        std::uint64_t size() const {
+            return _size;
+        }
+
+        // Maps [offset, offset + length) clamped to the file size. Offset may be arbitrary, it is aligned down internally.
+        MappedView map(std::uint64_t offset, std::size_t length) const {
+            MappedView result;
+
+            if (isOpen() && offset < _size && length) {
+                length = std::size_t(std::min(std::uint64_t(length), _size - offset));
+
+                std::uint64_t granularity = _granularity();
+                std::uint64_t base = offset - offset % granularity;
+                std::size_t shift = std::size_t(offset - base);
+
+            #ifdef _WIN32
+                void *address = ::MapViewOfFile(_mapping, FILE_MAP_READ, DWORD(base >> 32), DWORD(base & 0xffffffffu), shift + length);
+            #else
+                void *address = ::mmap(nullptr, shift + length, PROT_READ, MAP_SHARED, _file, off_t(base));
+                address = address != MAP_FAILED ? address : nullptr;
+            #endif
+
+                if (address) {
+                    result._base = address;
+                    result._baseSize = shift + length;
+                    result._shift = shift;
+                    result._size = length;
+                }
+            }
+
+            return result;
+        }
+
+    private:
+    #ifdef _WIN32
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+    #else
+        int _file = -1;
+    #endif
+        std::uint64_t _size = 0;
+
+        static std::uint64_t _granularity() {
+        #ifdef _WIN32
+            SYSTEM_INFO info;
+            ::GetSystemInfo(&info);
+            return info.dwAllocationGranularity;
+        #else
+            return std::uint64_t(::sysconf(_SC_PAGESIZE));
+        #endif
+        }
+    };
+}
@@ -17,6 +17,8 @@ namespace math
     struct vector4f;
     struct quaternion;
     struct transform2f;
+    struct matrix3f;
+    struct trs3f;
     struct transform3f;
     struct bound2f;
     struct bound3f;
@@ -67,6 +69,7 @@ namespace math
             vector2f clamped(scalar min, scalar max) const;
             vector2f bounded(const bound2f &b) const;
             
+            // point projected onto line p0 -> p1 if it is on the wrong side of it (exact side test)
             vector2f boundedToLeft(const vector2f &p0, const vector2f &p1) const;
             vector2f boundedToRight(const vector2f &p0, const vector2f &p1) const;
 
@@ -179,11 +182,14 @@ namespace math
             vector3f rotated(const vector3f &axis, scalar radians) const;
             vector3f transformed(const transform3f &trfm, bool likePosition = false) const;
             vector3f transformed(const quaternion &q) const;
+            vector3f transformed(const matrix3f &m) const;
+            vector3f transformed(const trs3f &trs, bool likePosition = false) const;
 
             // TODO: to all
             vector3f negatedX() const;
             
-            quaternion rotationTo(const vector3f &v);
+            // rotation turning this direction into direction of v: this->transformed(rotationTo(v)) is parallel to v
+            quaternion rotationTo(const vector3f &v) const;
 
             bool isNaN() const {
                 return std::isnan((*this)[Tx]) || std::isnan((*this)[Ty]) || std::isnan((*this)[Tz]);
@@ -766,6 +772,7 @@ namespace math
         quaternion() = default;
         quaternion(const quaternion &q) : x(q.x), y(q.y), z(q.z), w(q.w) {}
         quaternion(const transform3f &trfm);
+        explicit quaternion(const matrix3f &m);
 
         quaternion(const vector3f &axis, scalar radians) {
             scalar sina = std::sin(-radians * scalar(0.5));
@@ -787,7 +794,7 @@ namespace math
             return *this;
         }
 
-        quaternion operator *(const quaternion &q) {
+        quaternion operator *(const quaternion &q) const {
             return {
                 q.y * z - q.z * y + q.w * x + q.x * w,
                 q.z * x - q.x * z + q.w * y + q.y * w,
@@ -833,6 +840,16 @@ namespace math
             };
         }
         
+        // q = twist * swing: twist turns around unit 'axis' (in the space q is applied to), swing turns 'axis' to its rotated direction
+        void swingTwist(const vector3f &axis, quaternion &swing, quaternion &twist) const {
+            scalar d = x * axis.x + y * axis.y + z * axis.z;
+            scalar lengthSq = d * d + w * w;
+
+            // half turn around an axis orthogonal to 'axis' has no twist
+            twist = lengthSq > std::numeric_limits<scalar>::epsilon() * std::numeric_limits<scalar>::epsilon() ? quaternion(axis.x * d, axis.y * d, axis.z * d, w).normalized() : identity();
+            swing = twist.inverted() * *this;
+        }
+
         operator transform3f() const;
     };
     
@@ -972,6 +989,94 @@ namespace math
         }
     };
     
+    struct matrix3f {
+        union {
+            struct {
+                scalar _11, _12, _13;
+                scalar _21, _22, _23;
+                scalar _31, _32, _33;
+            };
+            struct {
+                scalar flat9[9];
+            };
+            struct {
+                vector3f &operator [](std::size_t index) {
+                    return *(reinterpret_cast<vector3f *>(this) + index);
+                }
+                const vector3f &operator [](std::size_t index) const {
+                    return *(reinterpret_cast<const vector3f *>(this) + index);
+                }
+            } rows;
+        };
+
+        static constexpr matrix3f identity() {
+            return {
+                1, 0, 0,
+                0, 1, 0,
+                0, 0, 1,
+            };
+        }
+
+        matrix3f() = default;
+        constexpr matrix3f(
+            scalar m11, scalar m12, scalar m13,
+            scalar m21, scalar m22, scalar m23,
+            scalar m31, scalar m32, scalar m33
+        ) : _11(m11), _12(m12), _13(m13),
+            _21(m21), _22(m22), _23(m23),
+            _31(m31), _32(m32), _33(m33) {}
+
+        explicit matrix3f(const quaternion &q);
+        explicit matrix3f(const transform3f &trfm);
+
+        matrix3f operator *(const matrix3f &m) const {
+            return {
+                _11 * m._11 + _12 * m._21 + _13 * m._31,
+                _11 * m._12 + _12 * m._22 + _13 * m._32,
+                _11 * m._13 + _12 * m._23 + _13 * m._33,
+                _21 * m._11 + _22 * m._21 + _23 * m._31,
+                _21 * m._12 + _22 * m._22 + _23 * m._32,
+                _21 * m._13 + _22 * m._23 + _23 * m._33,
+                _31 * m._11 + _32 * m._21 + _33 * m._31,
+                _31 * m._12 + _32 * m._22 + _33 * m._32,
+                _31 * m._13 + _32 * m._23 + _33 * m._33,
+            };
+        }
+
+        scalar determinant() const {
+            return _11 * (_22 * _33 - _32 * _23) - _12 * (_21 * _33 - _31 * _23) + _13 * (_21 * _32 - _31 * _22);
+        }
+
+        matrix3f transposed() const {
+            return {
+                _11, _21, _31,
+                _12, _22, _32,
+                _13, _23, _33,
+            };
+        }
+
+        // transposed() is the inverse for pure rotations
+        matrix3f inverted() const {
+            scalar det = scalar(1.0) / determinant();
+
+            return {
+                (_22 * _33 - _32 * _23) * det,
+                -(_12 * _33 - _32 * _13) * det,
+                (_12 * _23 - _22 * _13) * det,
+                -(_21 * _33 - _31 * _23) * det,
+                (_11 * _33 - _31 * _13) * det,
+                -(_11 * _23 - _21 * _13) * det,
+                (_21 * _32 - _31 * _22) * det,
+                -(_11 * _32 - _31 * _12) * det,
+                (_11 * _22 - _12 * _21) * det,
+            };
+        }
+
+        const scalar (&operator [](std::size_t index) const)[3] {
+            return reinterpret_cast<const scalar(&)[3]>(*(reinterpret_cast<const scalar *>(this) + 3 * index));
+        }
+    };
+
     struct transform3f {
         union {
             struct {
@@ -1019,6 +1124,18 @@ namespace math
         transform3f(const vector3f &translation, const quaternion &rotation) {
             *this = transform3f(rotation).translated(translation);
         }
+        explicit transform3f(const matrix3f &rotation) : transform3f(
+            rotation._11, rotation._12, rotation._13, 0,
+            rotation._21, rotation._22, rotation._23, 0,
+            rotation._31, rotation._32, rotation._33, 0,
+            0, 0, 0, 1
+        ) {}
+        transform3f(const vector3f &translation, const matrix3f &rotation) : transform3f(
+            rotation._11, rotation._12, rotation._13, 0,
+            rotation._21, rotation._22, rotation._23, 0,
+            rotation._31, rotation._32, rotation._33, 0,
+            translation.x, translation.y, translation.z, 1
+        ) {}
         transform3f(const vector3f &axis, scalar radians) {
             *this = quaternion(axis, radians);
         }
@@ -1133,6 +1250,11 @@ namespace math
             };
         }
 
+        // Splits affine transform built as scale * rotation * translation by normalizing rows of the upper 3x3.
+        // Shear is not handled, mirroring goes to negative scale.x. Matrix overload skips quaternion extraction.
+        void decompose(vector3f &translation, matrix3f &rotation, vector3f &scale) const;
+        void decompose(vector3f &translation, quaternion &rotation, vector3f &scale) const;
+
         // TODO: same methods for all
         transform3f withoutTranslation() const {
             return {
@@ -1198,6 +1320,31 @@ namespace math
         }
     };
     
+    // Scale, then rotation, then translation. Same as transform3f scale * rotation * translation in 40 bytes.
+    // Composition and inversion are exact for uniform scale. With non-uniform scale scales are multiplied componentwise,
+    // which is exact only while the child rotation keeps the axes aligned.
+    struct trs3f {
+        vector3f translation;
+        quaternion rotation;
+        vector3f scale;
+
+        static trs3f identity() {
+            return {{0, 0, 0}, quaternion::identity(), {1, 1, 1}};
+        }
+
+        trs3f() = default;
+        trs3f(const vector3f &translation, const quaternion &rotation, const vector3f &scale = vector3f(1)) : translation(translation), rotation(rotation), scale(scale) {}
+        explicit trs3f(const transform3f &trfm) {
+            trfm.decompose(translation, rotation, scale);
+        }
+
+        // this then trs, like transform3f multiplication
+        trs3f operator *(const trs3f &trs) const;
+        trs3f inverted() const;
+
+        operator transform3f() const;
+    };
+
     struct bound2f {
         union {
             struct {
@@ -1207,6 +1354,60 @@ namespace math
                 scalar ymax;
             };
         };
+
+        // inverted bound, merging anything into it gives that thing
+        static constexpr bound2f empty() {
+            return {
+                std::numeric_limits<scalar>::max(), std::numeric_limits<scalar>::max(),
+                -std::numeric_limits<scalar>::max(), -std::numeric_limits<scalar>::max(),
+            };
+        }
+
+        bound2f() = default;
+        constexpr bound2f(scalar xmin, scalar ymin, scalar xmax, scalar ymax) : xmin(xmin), ymin(ymin), xmax(xmax), ymax(ymax) {}
+        constexpr bound2f(const vector2f &min, const vector2f &max) : xmin(min.x), ymin(min.y), xmax(max.x), ymax(max.y) {}
+
+        bool isEmpty() const {
+            return xmin > xmax || ymin > ymax;
+        }
+
+        vector2f center() const {
+            return {scalar(0.5) * (xmin + xmax), scalar(0.5) * (ymin + ymax)};
+        }
+
+        // half of the size
+        vector2f extent() const {
+            return {scalar(0.5) * (xmax - xmin), scalar(0.5) * (ymax - ymin)};
+        }
+
+        bool contains(const vector2f &p) const {
+            return p.x >= xmin && p.x <= xmax && p.y >= ymin && p.y <= ymax;
+        }
+
+        bool intersects(const bound2f &b) const {
+            return xmin <= b.xmax && b.xmin <= xmax && ymin <= b.ymax && b.ymin <= ymax;
+        }
+
+        bound2f merged(const bound2f &b) const {
+            return {std::min(xmin, b.xmin), std::min(ymin, b.ymin), std::max(xmax, b.xmax), std::max(ymax, b.ymax)};
+        }
+
+        bound2f merged(const vector2f &p) const {
+            return {std::min(xmin, p.x), std::min(ymin, p.y), std::max(xmax, p.x), std::max(ymax, p.y)};
+        }
+
+        // Arvo's method: transformed center plus extent through the absolute matrix. Exact for affine transforms.
+        bound2f transformed(const transform2f &trfm) const {
+            if (isEmpty()) {
+                return *this;
+            }
+
+            vector2f c = center().transformed(trfm, true);
+            vector2f e = extent();
+            scalar ex = std::abs(trfm._11) * e.x + std::abs(trfm._21) * e.y;
+            scalar ey = std::abs(trfm._12) * e.x + std::abs(trfm._22) * e.y;
+            return {c.x - ex, c.y - ey, c.x + ex, c.y + ey};
+        }
     };
     
     struct bound3f {
@@ -1220,6 +1421,67 @@ namespace math
                 scalar zmax;
             };
         };
+
+        // inverted bound, merging anything into it gives that thing
+        static constexpr bound3f empty() {
+            return {
+                std::numeric_limits<scalar>::max(), std::numeric_limits<scalar>::max(), std::numeric_limits<scalar>::max(),
+                -std::numeric_limits<scalar>::max(), -std::numeric_limits<scalar>::max(), -std::numeric_limits<scalar>::max(),
+            };
+        }
+
+        bound3f() = default;
+        constexpr bound3f(scalar xmin, scalar ymin, scalar zmin, scalar xmax, scalar ymax, scalar zmax) : xmin(xmin), ymin(ymin), zmin(zmin), xmax(xmax), ymax(ymax), zmax(zmax) {}
+        constexpr bound3f(const vector3f &min, const vector3f &max) : xmin(min.x), ymin(min.y), zmin(min.z), xmax(max.x), ymax(max.y), zmax(max.z) {}
+
+        bool isEmpty() const {
+            return xmin > xmax || ymin > ymax || zmin > zmax;
+        }
+
+        vector3f center() const {
+            return {scalar(0.5) * (xmin + xmax), scalar(0.5) * (ymin + ymax), scalar(0.5) * (zmin + zmax)};
+        }
+
+        // half of the size
+        vector3f extent() const {
+            return {scalar(0.5) * (xmax - xmin), scalar(0.5) * (ymax - ymin), scalar(0.5) * (zmax - zmin)};
+        }
+
+        bool contains(const vector3f &p) const {
+            return p.x >= xmin && p.x <= xmax && p.y >= ymin && p.y <= ymax && p.z >= zmin && p.z <= zmax;
+        }
+
+        bool intersects(const bound3f &b) const {
+            return xmin <= b.xmax && b.xmin <= xmax && ymin <= b.ymax && b.ymin <= ymax && zmin <= b.zmax && b.zmin <= zmax;
+        }
+
+        bound3f merged(const bound3f &b) const {
+            return {
+                std::min(xmin, b.xmin), std::min(ymin, b.ymin), std::min(zmin, b.zmin),
+                std::max(xmax, b.xmax), std::max(ymax, b.ymax), std::max(zmax, b.zmax),
+            };
+        }
+
+        bound3f merged(const vector3f &p) const {
+            return {
+                std::min(xmin, p.x), std::min(ymin, p.y), std::min(zmin, p.z),
+                std::max(xmax, p.x), std::max(ymax, p.y), std::max(zmax, p.z),
+            };
+        }
+
+        // Arvo's method: transformed center plus extent through the absolute matrix. Exact for affine transforms, no 8 corners.
+        bound3f transformed(const transform3f &trfm) const {
+            if (isEmpty()) {
+                return *this;
+            }
+
+            vector3f c = center().transformed(trfm, true);
+            vector3f e = extent();
+            scalar ex = std::abs(trfm._11) * e.x + std::abs(trfm._21) * e.y + std::abs(trfm._31) * e.z;
+            scalar ey = std::abs(trfm._12) * e.x + std::abs(trfm._22) * e.y + std::abs(trfm._32) * e.z;
+            scalar ez = std::abs(trfm._13) * e.x + std::abs(trfm._23) * e.y + std::abs(trfm._33) * e.z;
+            return {c.x - ex, c.y - ey, c.z - ez, c.x + ex, c.y + ey, c.z + ez};
+        }
     };
     
     struct color {
@@ -1245,6 +1507,225 @@ namespace math
         }
     };
 
+    //----------------------------------------------------------------------------------------------------------------------------------------------------------
+    // Robust geometric predicates (Shewchuk). Determinant is computed in double and its sign is trusted if it exceeds the rounding error bound,
+    // otherwise it is recomputed exactly with floating-point expansions. Result is the exact sign: -1, 0 or 1.
+
+    namespace imp {
+        // Nonoverlapping expansion: sum of components sorted by increasing magnitude, zero components eliminated
+        template <std::size_t N> struct expansion {
+            double c[N];
+            std::size_t count = 0;
+
+            int sign() const {
+                return count == 0 ? 0 : c[count - 1] > 0.0 ? 1 : -1;
+            }
+        };
+
+        inline void twoSum(double a, double b, double &x, double &y) {
+            x = a + b;
+            double bv = x - a;
+            double av = x - bv;
+            y = (a - av) + (b - bv);
+        }
+
+        inline expansion<2> exactDiff(double a, double b) {
+            expansion<2> result;
+            double x = a - b;
+            double bv = a - x;
+            double av = x + bv;
+            double y = (a - av) + (bv - b);
+
+            if (y != 0.0) result.c[result.count++] = y;
+            if (x != 0.0) result.c[result.count++] = x;
+            return result;
+        }
+
+        template <std::size_t N, std::size_t M> inline expansion<N + M> exactSum(const expansion<N> &e, const expansion<M> &f) {
+            expansion<N + M> result;
+            std::size_t i = 0, k = 0;
+            double q = 0.0, x, y;
+
+            // merge by magnitude, then carry q through every component
+            auto next = [&]() {
+                return k >= f.count || (i < e.count && std::abs(e.c[i]) < std::abs(f.c[k])) ? e.c[i++] : f.c[k++];
+            };
+
+            if (e.count + f.count) {
+                q = next();
+            }
+            while (i < e.count || k < f.count) {
+                twoSum(q, next(), x, y);
+                q = x;
+
+                if (y != 0.0) {
+                    result.c[result.count++] = y;
+                }
+            }
+            if (q != 0.0) {
+                result.c[result.count++] = q;
+            }
+
+            return result;
+        }
+
+        template <std::size_t N> inline expansion<N> exactNegated(expansion<N> e) {
+            for (std::size_t i = 0; i < e.count; i++) {
+                e.c[i] = -e.c[i];
+            }
+            return e;
+        }
+
+        template <std::size_t N> inline expansion<2 * N> exactScaled(const expansion<N> &e, double b) {
+            expansion<2 * N> result;
+            double q, x, y;
+
+            // fma gives exact low part of the product
+            for (std::size_t i = 0; i < e.count; i++) {
+                double p = e.c[i] * b;
+                double pe = std::fma(e.c[i], b, -p);
+
+                if (i == 0) {
+                    q = p;
+                    y = pe;
+                }
+                else {
+                    twoSum(q, pe, x, y);
+                    if (y != 0.0) result.c[result.count++] = y;
+                    twoSum(p, x, q, y);
+                }
+                if (y != 0.0) {
+                    result.c[result.count++] = y;
+                }
+            }
+            if (e.count && q != 0.0) {
+                result.c[result.count++] = q;
+            }
+
+            return result;
+        }
+
+        template <std::size_t N, std::size_t M> inline expansion<2 * N * M> exactProduct(const expansion<N> &e, const expansion<M> &f) {
+            expansion<2 * N * M> result;
+
+            for (std::size_t i = 0; i < f.count; i++) {
+                expansion<2 * N> part = exactScaled(e, f.c[i]);
+                auto sum = exactSum(result, part);
+
+                std::copy(sum.c, sum.c + sum.count, result.c);
+                result.count = sum.count;
+            }
+
+            return result;
+        }
+
+        constexpr double PREDICATE_EPSILON = std::numeric_limits<double>::epsilon() * 0.5;
+        constexpr double ORIENT2_BOUND = (3.0 + 16.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON;
+        constexpr double ORIENT3_BOUND = (7.0 + 56.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON;
+        constexpr double INCIRCLE_BOUND = (10.0 + 96.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON;
+
+        inline int signOf(double value) {
+            return value > 0.0 ? 1 : value < 0.0 ? -1 : 0;
+        }
+
+        inline int orient2dExact(const vector2f &a, const vector2f &b, const vector2f &c) {
+            expansion<8> left = exactProduct(exactDiff(a.x, c.x), exactDiff(b.y, c.y));
+            expansion<8> right = exactProduct(exactDiff(a.y, c.y), exactDiff(b.x, c.x));
+            return exactSum(left, exactNegated(right)).sign();
+        }
+
+        inline int orient3dExact(const vector3f &a, const vector3f &b, const vector3f &c, const vector3f &d) {
+            expansion<2> adx = exactDiff(a.x, d.x), ady = exactDiff(a.y, d.y), adz = exactDiff(a.z, d.z);
+            expansion<2> bdx = exactDiff(b.x, d.x), bdy = exactDiff(b.y, d.y), bdz = exactDiff(b.z, d.z);
+            expansion<2> cdx = exactDiff(c.x, d.x), cdy = exactDiff(c.y, d.y), cdz = exactDiff(c.z, d.z);
+
+            expansion<16> bc = exactSum(exactProduct(bdx, cdy), exactNegated(exactProduct(bdy, cdx)));
+            expansion<16> ca = exactSum(exactProduct(cdx, ady), exactNegated(exactProduct(cdy, adx)));
+            expansion<16> ab = exactSum(exactProduct(adx, bdy), exactNegated(exactProduct(ady, bdx)));
+
+            return exactSum(exactSum(exactProduct(bc, adz), exactProduct(ca, bdz)), exactProduct(ab, cdz)).sign();
+        }
+
+        inline int incircleExact(const vector2f &a, const vector2f &b, const vector2f &c, const vector2f &d) {
+            expansion<2> adx = exactDiff(a.x, d.x), ady = exactDiff(a.y, d.y);
+            expansion<2> bdx = exactDiff(b.x, d.x), bdy = exactDiff(b.y, d.y);
+            expansion<2> cdx = exactDiff(c.x, d.x), cdy = exactDiff(c.y, d.y);
+
+            expansion<16> alift = exactSum(exactProduct(adx, adx), exactProduct(ady, ady));
+            expansion<16> blift = exactSum(exactProduct(bdx, bdx), exactProduct(bdy, bdy));
+            expansion<16> clift = exactSum(exactProduct(cdx, cdx), exactProduct(cdy, cdy));
+
+            expansion<16> bc = exactSum(exactProduct(bdx, cdy), exactNegated(exactProduct(bdy, cdx)));
+            expansion<16> ca = exactSum(exactProduct(cdx, ady), exactNegated(exactProduct(cdy, adx)));
+            expansion<16> ab = exactSum(exactProduct(adx, bdy), exactNegated(exactProduct(ady, bdx)));
+
+            return exactSum(exactSum(exactProduct(alift, bc), exactProduct(blift, ca)), exactProduct(clift, ab)).sign();
+        }
+    }
+
+    // 1 if a, b, c go counter-clockwise (c is to the left of a -> b), -1 if clockwise, 0 if collinear
+    inline int orient2d(const vector2f &a, const vector2f &b, const vector2f &c) {
+        double left = (double(a.x) - double(c.x)) * (double(b.y) - double(c.y));
+        double right = (double(a.y) - double(c.y)) * (double(b.x) - double(c.x));
+        double det = left - right;
+
+        if (std::abs(det) >= imp::ORIENT2_BOUND * (std::abs(left) + std::abs(right))) {
+            return imp::signOf(det);
+        }
+
+        return imp::orient2dExact(a, b, c);
+    }
+
+    // 1 if d is below the plane of a, b, c, where 'below' means a, b, c look counter-clockwise from above, -1 if above, 0 if coplanar
+    inline int orient3d(const vector3f &a, const vector3f &b, const vector3f &c, const vector3f &d) {
+        double adx = double(a.x) - d.x, ady = double(a.y) - d.y, adz = double(a.z) - d.z;
+        double bdx = double(b.x) - d.x, bdy = double(b.y) - d.y, bdz = double(b.z) - d.z;
+        double cdx = double(c.x) - d.x, cdy = double(c.y) - d.y, cdz = double(c.z) - d.z;
+
+        double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+        double cdxady = cdx * ady, adxcdy = adx * cdy;
+        double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+        double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+        double permanent =
+            (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz) +
+            (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz) +
+            (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+
+        if (std::abs(det) > imp::ORIENT3_BOUND * permanent) {
+            return imp::signOf(det);
+        }
+
+        return imp::orient3dExact(a, b, c, d);
+    }
+
+    // 1 if d is inside the circle through counter-clockwise a, b, c, -1 if outside, 0 if on it. Sign flips for clockwise a, b, c
+    inline int incircle(const vector2f &a, const vector2f &b, const vector2f &c, const vector2f &d) {
+        double adx = double(a.x) - d.x, ady = double(a.y) - d.y;
+        double bdx = double(b.x) - d.x, bdy = double(b.y) - d.y;
+        double cdx = double(c.x) - d.x, cdy = double(c.y) - d.y;
+
+        double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+        double cdxady = cdx * ady, adxcdy = adx * cdy;
+        double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+        double alift = adx * adx + ady * ady;
+        double blift = bdx * bdx + bdy * bdy;
+        double clift = cdx * cdx + cdy * cdy;
+
+        double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+        double permanent =
+            (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift +
+            (std::abs(cdxady) + std::abs(adxcdy)) * blift +
+            (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+
+        if (std::abs(det) > imp::INCIRCLE_BOUND * permanent) {
+            return imp::signOf(det);
+        }
+
+        return imp::incircleExact(a, b, c, d);
+    }
+
     namespace imp {
         //----------------------------------------------------------------------------------------------------------------------------------------------------------
         // vector2f methods
@@ -1349,11 +1830,13 @@ namespace math
         }
 
         template <std::size_t Tx, std::size_t Ty> inline vector2f vector2base<Tx, Ty>::boundedToLeft(const vector2f &p0, const vector2f &p1) const {
-            // TODO: implement
+            vector2f self = *this;
+            return orient2d(p0, p1, self) < 0 ? p0 + (self - p0).projectedTo(p1 - p0) : self;
         }
 
         template <std::size_t Tx, std::size_t Ty> inline vector2f vector2base<Tx, Ty>::boundedToRight(const vector2f &p0, const vector2f &p1) const {
-            // TODO: implement
+            vector2f self = *this;
+            return orient2d(p0, p1, self) > 0 ? p0 + (self - p0).projectedTo(p1 - p0) : self;
         }
 
         template <std::size_t Tx, std::size_t Ty> inline vector2f vector2base<Tx, Ty>::normalized(scalar ln) const {
@@ -1383,11 +1866,13 @@ namespace math
         }
 
         template <std::size_t Tx, std::size_t Ty> inline vector2f vector2base<Tx, Ty>::reflectedBy(const vector2f &nrm) const {
-            // TODO: implement
+            scalar k = scalar(2.0) * dot(nrm);
+            return {(*this)[Tx] - k * nrm.x, (*this)[Ty] - k * nrm.y};
         }
 
         template <std::size_t Tx, std::size_t Ty> inline vector2f vector2base<Tx, Ty>::projectedTo(const vector2f &v) const {
-            // TODO: implement
+            scalar lsq = v.lengthSq();
+            return lsq > std::numeric_limits<scalar>::epsilon() ? v * (dot(v) / lsq) : vector2f{0, 0};
         }
 
         template <std::size_t Tx, std::size_t Ty> inline vector2f vector2base<Tx, Ty>::directionTo(const vector2f &point) const {
@@ -1503,6 +1988,10 @@ namespace math
             return {v0[X0] / v1[X1], v0[Y0] / v1[Y1], v0[Z0] / v1[Z1]};
         }
 
+        template <std::size_t X, std::size_t Y, std::size_t Z> inline vector3f operator -(const vector3base<X, Y, Z> &v) {
+            return {-v[X], -v[Y], -v[Z]};
+        }
+
         template <std::size_t Tx, std::size_t Ty, std::size_t Tz> inline scalar vector3base<Tx, Ty, Tz>::distanceTo(const vector3f &v) const {
             scalar dx = v.x - (*this)[Tx];
             scalar dy = v.y - (*this)[Ty];
@@ -1564,11 +2053,13 @@ namespace math
         }
     
         template <std::size_t Tx, std::size_t Ty, std::size_t Tz> inline vector3f vector3base<Tx, Ty, Tz>::reflectedBy(const vector3f &nrm) const {
-            // TODO: implement
+            scalar k = scalar(2.0) * dot(nrm);
+            return {(*this)[Tx] - k * nrm.x, (*this)[Ty] - k * nrm.y, (*this)[Tz] - k * nrm.z};
         }
 
         template <std::size_t Tx, std::size_t Ty, std::size_t Tz> inline vector3f vector3base<Tx, Ty, Tz>::projectedTo(const vector3f &v) const {
-            // TODO: implement
+            scalar lsq = v.lengthSq();
+            return lsq > std::numeric_limits<scalar>::epsilon() ? v * (dot(v) / lsq) : vector3f{0, 0, 0};
         }
 
         template <std::size_t Tx, std::size_t Ty, std::size_t Tz> inline vector3f vector3base<Tx, Ty, Tz>::directionTo(const vector3f &point) const {
@@ -1666,13 +2157,60 @@ namespace math
             return {p.x, p.y, p.z};
         }
 
+        template <std::size_t Tx, std::size_t Ty, std::size_t Tz>
+        inline vector3f vector3base<Tx, Ty, Tz>::transformed(const matrix3f &m) const {
+            scalar tx = (*this)[Tx];
+            scalar ty = (*this)[Ty];
+            scalar tz = (*this)[Tz];
+
+            return {
+                tx * m._11 + ty * m._21 + tz * m._31,
+                tx * m._12 + ty * m._22 + tz * m._32,
+                tx * m._13 + ty * m._23 + tz * m._33,
+            };
+        }
+
+        // v + 2w(u x v) + 2u x (u x v), same rotation as transformed(quaternion) without two quaternion products
+        inline vector3f rotatedBy(const vector3f &v, const quaternion &q) {
+            scalar tx = scalar(2.0) * (q.y * v.z - q.z * v.y);
+            scalar ty = scalar(2.0) * (q.z * v.x - q.x * v.z);
+            scalar tz = scalar(2.0) * (q.x * v.y - q.y * v.x);
+
+            return {
+                v.x + q.w * tx + (q.y * tz - q.z * ty),
+                v.y + q.w * ty + (q.z * tx - q.x * tz),
+                v.z + q.w * tz + (q.x * ty - q.y * tx),
+            };
+        }
+
+        template <std::size_t Tx, std::size_t Ty, std::size_t Tz>
+        inline vector3f vector3base<Tx, Ty, Tz>::transformed(const trs3f &trs, bool likePosition) const {
+            vector3f result = rotatedBy({(*this)[Tx] * trs.scale.x, (*this)[Ty] * trs.scale.y, (*this)[Tz] * trs.scale.z}, trs.rotation);
+            return likePosition ? result + trs.translation : result;
+        }
+
         template <std::size_t Tx, std::size_t Ty, std::size_t Tz>
         inline vector3f vector3base<Tx, Ty, Tz>::negatedX() const {
             return {-(*this)[Tx], (*this)[Ty], (*this)[Tz]};
         }
     
-        template <std::size_t Tx, std::size_t Ty, std::size_t Tz> inline quaternion vector3base<Tx, Ty, Tz>::rotationTo(const vector3f &v) {
-            // TODO: implement
+        // Shortest arc: half-way quaternion (a x b, |a||b| + a.b) normalized. Opposite vectors turn around any orthogonal axis.
+        template <std::size_t Tx, std::size_t Ty, std::size_t Tz> inline quaternion vector3base<Tx, Ty, Tz>::rotationTo(const vector3f &v) const {
+            scalar tx = (*this)[Tx];
+            scalar ty = (*this)[Ty];
+            scalar tz = (*this)[Tz];
+            scalar lengths = std::sqrt(lengthSq() * v.lengthSq());
+            scalar w = lengths + dot(v);
+
+            if (lengths <= std::numeric_limits<scalar>::epsilon()) {
+                return quaternion::identity();
+            }
+            if (w <= lengths * std::numeric_limits<scalar>::epsilon()) {
+                vector3f axis = std::abs(tx) > std::abs(tz) ? vector3f(-ty, tx, 0) : vector3f(0, -tz, ty);
+                return quaternion(axis.x, axis.y, axis.z, 0).normalized();
+            }
+
+            return quaternion(ty * v.z - tz * v.y, tz * v.x - tx * v.z, tx * v.y - ty * v.x, w).normalized();
         }
     }
     
@@ -1766,6 +2304,16 @@ namespace math
         }
     }
 
+    // full 4D row-vector product, w is not assumed to be 1 or 0
+    inline vector4f vector4f::transformed(const transform3f &trfm) const {
+        return {
+            x * trfm._11 + y * trfm._21 + z * trfm._31 + w * trfm._41,
+            x * trfm._12 + y * trfm._22 + z * trfm._32 + w * trfm._42,
+            x * trfm._13 + y * trfm._23 + z * trfm._33 + w * trfm._43,
+            x * trfm._14 + y * trfm._24 + z * trfm._34 + w * trfm._44,
+        };
+    }
+
     inline quaternion::operator transform3f() const {
         scalar xx = scalar(2.0) * x * x;
         scalar xy = scalar(2.0) * x * y;
@@ -1800,6 +2348,127 @@ namespace math
         };
     }
     
+    inline quaternion::quaternion(const matrix3f &m) {
+        scalar trace = m._11 + m._22 + m._33;
+
+        if (trace > scalar(0.0)) {
+            scalar s = scalar(0.5) / std::sqrt(trace + scalar(1.0));
+            x = (m._23 - m._32) * s;
+            y = (m._31 - m._13) * s;
+            z = (m._12 - m._21) * s;
+            w = scalar(0.25) / s;
+        }
+        else if (m._11 > m._22 && m._11 > m._33) {
+            scalar s = scalar(0.5) / std::sqrt(scalar(1.0) + m._11 - m._22 - m._33);
+            x = scalar(0.25) / s;
+            y = (m._12 + m._21) * s;
+            z = (m._13 + m._31) * s;
+            w = (m._23 - m._32) * s;
+        }
+        else if (m._22 > m._33) {
+            scalar s = scalar(0.5) / std::sqrt(scalar(1.0) + m._22 - m._11 - m._33);
+            x = (m._12 + m._21) * s;
+            y = scalar(0.25) / s;
+            z = (m._23 + m._32) * s;
+            w = (m._31 - m._13) * s;
+        }
+        else {
+            scalar s = scalar(0.5) / std::sqrt(scalar(1.0) + m._33 - m._11 - m._22);
+            x = (m._13 + m._31) * s;
+            y = (m._23 + m._32) * s;
+            z = scalar(0.25) / s;
+            w = (m._12 - m._21) * s;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------------------------------------------------------------------
+    // matrix3f methods
+
+    inline matrix3f::matrix3f(const quaternion &q) {
+        scalar xx = scalar(2.0) * q.x * q.x;
+        scalar xy = scalar(2.0) * q.x * q.y;
+        scalar xz = scalar(2.0) * q.x * q.z;
+        scalar yy = scalar(2.0) * q.y * q.y;
+        scalar yz = scalar(2.0) * q.y * q.z;
+        scalar zz = scalar(2.0) * q.z * q.z;
+        scalar wx = scalar(2.0) * q.w * q.x;
+        scalar wy = scalar(2.0) * q.w * q.y;
+        scalar wz = scalar(2.0) * q.w * q.z;
+
+        _11 = scalar(1.0) - (yy + zz);
+        _12 = xy + wz;
+        _13 = xz - wy;
+        _21 = xy - wz;
+        _22 = scalar(1.0) - (xx + zz);
+        _23 = yz + wx;
+        _31 = xz + wy;
+        _32 = yz - wx;
+        _33 = scalar(1.0) - (xx + yy);
+    }
+
+    inline matrix3f::matrix3f(const transform3f &trfm) : matrix3f(
+        trfm._11, trfm._12, trfm._13,
+        trfm._21, trfm._22, trfm._23,
+        trfm._31, trfm._32, trfm._33
+    ) {}
+
+    //----------------------------------------------------------------------------------------------------------------------------------------------------------
+    // transform3f methods
+
+    inline void transform3f::decompose(vector3f &translation, matrix3f &rotation, vector3f &scale) const {
+        rotation = matrix3f(*this);
+        translation = {_41, _42, _43};
+        scale = {rotation.rows[0].length(), rotation.rows[1].length(), rotation.rows[2].length()};
+
+        if (rotation.determinant() < scalar(0.0)) {
+            scale.x = -scale.x;
+        }
+
+        for (std::size_t i = 0; i < 3; i++) {
+            scalar s = scale[i];
+            rotation.rows[i] = std::abs(s) > std::numeric_limits<scalar>::epsilon() ? rotation.rows[i] / s : rotation.rows[i];
+        }
+    }
+
+    inline void transform3f::decompose(vector3f &translation, quaternion &rotation, vector3f &scale) const {
+        matrix3f m;
+        decompose(translation, m, scale);
+        rotation = quaternion(m);
+    }
+
+    //----------------------------------------------------------------------------------------------------------------------------------------------------------
+    // trs3f methods
+
+    inline trs3f trs3f::operator *(const trs3f &trs) const {
+        return {
+            imp::rotatedBy(translation * trs.scale, trs.rotation) + trs.translation,
+            rotation * trs.rotation,
+            scale * trs.scale,
+        };
+    }
+
+    inline trs3f trs3f::inverted() const {
+        vector3f invScale = scalar(1.0) / scale;
+        quaternion invRotation = rotation.inverted();
+
+        return {
+            -imp::rotatedBy(translation, invRotation) * invScale,
+            invRotation,
+            invScale,
+        };
+    }
+
+    inline trs3f::operator transform3f() const {
+        matrix3f m (rotation);
+
+        return {
+            m._11 * scale.x, m._12 * scale.x, m._13 * scale.x, 0,
+            m._21 * scale.y, m._22 * scale.y, m._23 * scale.y, 0,
+            m._31 * scale.z, m._32 * scale.z, m._33 * scale.z, 0,
+            translation.x, translation.y, translation.z, 1,
+        };
+    }
+
     constexpr scalar PI = scalar(3.141592653589793);
     constexpr scalar PI_2 = PI / scalar(2.0);
     constexpr scalar PI_4 = PI / scalar(4.0);
@@ -1812,7 +2481,12 @@ namespace math
     static_assert(sizeof(vector4f) == 4 * sizeof(scalar), "layout error");
     static_assert(sizeof(quaternion) == 4 * sizeof(scalar), "layout error");
     static_assert(sizeof(transform2f) == 9 * sizeof(scalar), "layout error");
+    static_assert(sizeof(matrix3f) == 9 * sizeof(scalar), "layout error");
+    static_assert(sizeof(trs3f) == 10 * sizeof(scalar), "layout error");
     static_assert(sizeof(transform3f) == 16 * sizeof(scalar), "layout error");
+    static_assert(sizeof(bound2f) == 4 * sizeof(scalar), "layout error");
+    static_assert(sizeof(bound3f) == 6 * sizeof(scalar), "layout error");
+    static_assert(sizeof(color) == 4 * sizeof(scalar), "layout error");
 }
 
 
@@ -0,0 +1,333 @@
+#pragma once
+
+// Versioned binary container for arrays of math types.
+//
+// Layout (little endian, every block starts at a multiple of ARCHIVE_ALIGNMENT):
+//   file header   64 bytes : magic "MATHARR\0", version, alignment
+//   array header  64 bytes : element type, element size, element count, name
+//   payload       count * element size bytes, raw memory image of the elements
+//   padding       up to the next multiple of ARCHIVE_ALIGNMENT
+//   ...           next array header
+//
+// Payload is the memory image of the types, so the reader hands out pointers into the mapping without any copy.
+// This relies on the layout static_asserts at the end of math.h.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "math.h"
+#include "mappedfile.h"
+
+namespace math
+{
+    constexpr std::uint32_t ARCHIVE_VERSION = 1;
+    constexpr std::size_t ARCHIVE_ALIGNMENT = 64;
+
+    namespace imp {
+        template <typename> struct ArchiveType {};
+        template <> struct ArchiveType<scalar> { static constexpr std::uint32_t value = 1; };
+        template <> struct ArchiveType<vector2f> { static constexpr std::uint32_t value = 2; };
+        template <> struct ArchiveType<vector3f> { static constexpr std::uint32_t value = 3; };
+        template <> struct ArchiveType<vector4f> { static constexpr std::uint32_t value = 4; };
+        template <> struct ArchiveType<quaternion> { static constexpr std::uint32_t value = 5; };
+        template <> struct ArchiveType<transform2f> { static constexpr std::uint32_t value = 6; };
+        template <> struct ArchiveType<transform3f> { static constexpr std::uint32_t value = 7; };
+        template <> struct ArchiveType<bound2f> { static constexpr std::uint32_t value = 8; };
+        template <> struct ArchiveType<bound3f> { static constexpr std::uint32_t value = 9; };
+        template <> struct ArchiveType<color> { static constexpr std::uint32_t value = 10; };
+
+        struct ArchiveFileHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t alignment;
+            std::uint8_t reserved[48];
+        };
+
+        struct ArchiveArrayHeader {
+            std::uint32_t type;
+            std::uint32_t elementSize;
+            std::uint64_t count;
+            char name[48];
+        };
+
+        static_assert(sizeof(ArchiveFileHeader) == ARCHIVE_ALIGNMENT, "layout error");
+        static_assert(sizeof(ArchiveArrayHeader) == ARCHIVE_ALIGNMENT, "layout error");
+
+        constexpr char ARCHIVE_MAGIC[8] = {'M', 'A', 'T', 'H', 'A', 'R', 'R', '\0'};
+
+        inline std::uint64_t archiveAligned(std::uint64_t offset) {
+            return (offset + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT * ARCHIVE_ALIGNMENT;
+        }
+    }
+
+    // Typed read-only span over archive payload
+    template <typename T> struct ArrayView {
+        const T *data = nullptr;
+        std::size_t count = 0;
+
+        const T *begin() const {
+            return data;
+        }
+        const T *end() const {
+            return data + count;
+        }
+        const T &operator [](std::size_t index) const {
+            return data[index];
+        }
+        bool empty() const {
+            return count == 0;
+        }
+    };
+
+    //------------------------------------------------------------------------------------------------------------------------------------------------------
+    // Streaming writer. Array payload goes straight to the file chunk by chunk, so arrays may be larger than RAM.
+    //
+    //   writer.open("points.bin");
+    //   writer.beginArray<vector3f>("points");
+    //   while (...) writer.write(chunk, chunkCount);
+    //   writer.endArray();
+    //   writer.close();
+
+    class ArrayFileWriter : utility::NonCopyable {
+    public:
+        ArrayFileWriter() = default;
+        ~ArrayFileWriter() {
+            close();
+        }
+
+        bool open(const char *path) {
+            close();
+
+            imp::ArchiveFileHeader header {};
+            std::memcpy(header.magic, imp::ARCHIVE_MAGIC, sizeof(header.magic));
+            header.version = ARCHIVE_VERSION;
+            header.alignment = std::uint32_t(ARCHIVE_ALIGNMENT);
+
+            if ((_file = std::fopen(path, "wb")) != nullptr) {
+                _failed = std::fwrite(&header, sizeof(header), 1, _file) != 1;
+                return !_failed;
+            }
+
+            return false;
+        }
+
+        // closes current array if any, returns false if anything failed since open()
+        bool close() {
+            bool result = false;
+
+            if (_file) {
+                endArray();
+                result = std::fclose(_file) == 0 && !_failed;
+                _file = nullptr;
+            }
+
+            return result;
+        }
+
+        template <typename T> bool beginArray(const char *name) {
+            endArray();
+
+            if (_file && !_failed && std::strlen(name) < sizeof(_header.name)) {
+                _header = {};
+                _header.type = imp::ArchiveType<T>::value;
+                _header.elementSize = std::uint32_t(sizeof(T));
+                std::memcpy(_header.name, name, std::strlen(name));
+
+                _failed = std::fgetpos(_file, &_headerPosition) != 0 || std::fwrite(&_header, sizeof(_header), 1, _file) != 1;
+                _inArray = !_failed;
+                return _inArray;
+            }
+
+            return false;
+        }
+
+        template <typename T> bool write(const T *data, std::size_t count) {
+            if (_inArray && !_failed && _header.type == imp::ArchiveType<T>::value) {
+                _failed = std::fwrite(data, sizeof(T), count, _file) != count;
+                _header.count += count;
+                return !_failed;
+            }
+
+            return false;
+        }
+
+        // patches element count into the array header and pads the payload
+        bool endArray() {
+            if (_inArray) {
+                static const std::uint8_t zeroes[ARCHIVE_ALIGNMENT] = {};
+                std::uint64_t payload = _header.count * _header.elementSize;
+                std::size_t padding = std::size_t(imp::archiveAligned(payload) - payload);
+
+                _inArray = false;
+                _failed = _failed
+                    || std::fsetpos(_file, &_headerPosition) != 0
+                    || std::fwrite(&_header, sizeof(_header), 1, _file) != 1
+                    || std::fseek(_file, 0, SEEK_END) != 0
+                    || std::fwrite(zeroes, 1, padding, _file) != padding;
+            }
+
+            return _file && !_failed;
+        }
+
+    private:
+        std::FILE *_file = nullptr;
+        std::fpos_t _headerPosition = {};
+        imp::ArchiveArrayHeader _header = {};
+        bool _inArray = false;
+        bool _failed = false;
+    };
+
+    //------------------------------------------------------------------------------------------------------------------------------------------------------
+    // Finds payload of the named array by mapping headers one by one. For out-of-core processing through MappedFile::map windows.
+
+    template <typename T> bool findArchiveArray(const utility::MappedFile &file, const char *name, std::uint64_t &payloadOffset, std::uint64_t &count) {
+        utility::MappedView view = file.map(0, sizeof(imp::ArchiveFileHeader));
+
+        if (view.size() == sizeof(imp::ArchiveFileHeader)) {
+            const imp::ArchiveFileHeader *fileHeader = reinterpret_cast<const imp::ArchiveFileHeader *>(view.data());
+
+            if (std::memcmp(fileHeader->magic, imp::ARCHIVE_MAGIC, sizeof(fileHeader->magic)) != 0 || fileHeader->version > ARCHIVE_VERSION || fileHeader->alignment != ARCHIVE_ALIGNMENT) {
+                return false;
+            }
+
+            std::uint64_t offset = sizeof(imp::ArchiveFileHeader);
+
+            while (offset + sizeof(imp::ArchiveArrayHeader) <= file.size()) {
+                view = file.map(offset, sizeof(imp::ArchiveArrayHeader));
+
+                if (view.size() != sizeof(imp::ArchiveArrayHeader)) {
+                    return false;
+                }
+
+                const imp::ArchiveArrayHeader *header = reinterpret_cast<const imp::ArchiveArrayHeader *>(view.data());
+                std::uint64_t payload = header->count * header->elementSize;
+
+                if (header->elementSize == 0 || payload / header->elementSize != header->count || payload > file.size() - offset - sizeof(*header)) {
+                    return false;
+                }
+                if (std::memchr(header->name, 0, sizeof(header->name)) == nullptr) {
+                    return false;
+                }
+                if (std::strncmp(header->name, name, sizeof(header->name)) == 0 && header->type == imp::ArchiveType<T>::value && header->elementSize == sizeof(T)) {
+                    payloadOffset = offset + sizeof(*header);
+                    count = header->count;
+                    return true;
+                }
+
+                offset = imp::archiveAligned(offset + sizeof(*header) + payload);
+            }
+        }
+
+        return false;
+    }
+
+    //------------------------------------------------------------------------------------------------------------------------------------------------------
+    // Zero-copy reader. Maps the whole file once, array() returns spans pointing into the mapping.
+
+    class ArrayFileReader : utility::NonCopyable {
+    public:
+        ArrayFileReader() = default;
+        ~ArrayFileReader() {
+            close();
+        }
+
+        // false if file can't be mapped, is not an archive, has newer version, is truncated or has an array name without terminating zero
+        bool open(const char *path) {
+            close();
+
+            if (_file.open(path) && _file.size() >= sizeof(imp::ArchiveFileHeader)) {
+                _view = _file.map(0, std::size_t(_file.size()));
+
+                if (_view && _parse()) {
+                    return true;
+                }
+            }
+
+            close();
+            return false;
+        }
+
+        void close() {
+            _arrays.clear();
+            _view.reset();
+            _file.close();
+        }
+
+        std::size_t arrayCount() const {
+            return _arrays.size();
+        }
+
+        // nullptr for index out of range
+        const char *arrayName(std::size_t index) const {
+            return index < _arrays.size() ? _arrays[index].header->name : nullptr;
+        }
+
+        template <typename T> bool isArrayOf(std::size_t index) const {
+            return index < _arrays.size() && _arrays[index].header->type == imp::ArchiveType<T>::value && _arrays[index].header->elementSize == sizeof(T);
+        }
+
+        // empty view if there is no array with such name and type
+        template <typename T> ArrayView<T> array(const char *name) const {
+            for (std::size_t i = 0; i < _arrays.size(); i++) {
+                if (std::strncmp(_arrays[i].header->name, name, sizeof(_arrays[i].header->name)) == 0 && isArrayOf<T>(i)) {
+                    return array<T>(i);
+                }
+            }
+
+            return {};
+        }
+
+        // empty view if index is out of range or array has another type
+        template <typename T> ArrayView<T> array(std::size_t index) const {
+            ArrayView<T> result;
+
+            if (isArrayOf<T>(index)) {
+                result.data = reinterpret_cast<const T *>(_arrays[index].payload);
+                result.count = std::size_t(_arrays[index].header->count);
+            }
+
+            return result;
+        }
+
+    private:
+        struct Entry {
+            const imp::ArchiveArrayHeader *header;
+            const std::uint8_t *payload;
+        };
+
+        utility::MappedFile _file;
+        utility::MappedView _view;
+        std::vector<Entry> _arrays;
+
+        bool _parse() {
+            const imp::ArchiveFileHeader *fileHeader = reinterpret_cast<const imp::ArchiveFileHeader *>(_view.data());
+
+            if (std::memcmp(fileHeader->magic, imp::ARCHIVE_MAGIC, sizeof(fileHeader->magic)) != 0 || fileHeader->version > ARCHIVE_VERSION) {
+                return false;
+            }
+            if (fileHeader->alignment != ARCHIVE_ALIGNMENT) {
+                return false;
+            }
+
+            std::uint64_t offset = sizeof(imp::ArchiveFileHeader);
+            std::uint64_t size = _view.size();
+
+            while (offset + sizeof(imp::ArchiveArrayHeader) <= size) {
+                const imp::ArchiveArrayHeader *header = reinterpret_cast<const imp::ArchiveArrayHeader *>(_view.data() + offset);
+                std::uint64_t payload = header->count * header->elementSize;
+
+                if (header->elementSize == 0 || payload / header->elementSize != header->count || payload > size - offset - sizeof(*header)) {
+                    return false;
+                }
+                if (std::memchr(header->name, 0, sizeof(header->name)) == nullptr) {
+                    return false;
+                }
+
+                _arrays.push_back({header, _view.data() + offset + sizeof(*header)});
+                offset = imp::archiveAligned(offset + sizeof(*header) + payload);
+            }
+
+            return offset >= size;
+        }
+    };
+}
@@ -0,0 +1,1132 @@
+#pragma once
+
+// Batch kernels over plain arrays of math types.
+// Every kernel takes a pointer and an element count, processes 4 elements per step with SSE2 where available
+// and falls back to the scalar methods of math.h for the tail and for targets without SSE2.
+
+#include <cstddef>
+#include <cstdint>
+#include "math.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MATH_BATCH_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace math
+{
+    namespace imp {
+        // laneFloor clamps input to [-LANE_FLOOR_LIMIT, LANE_FLOOR_LIMIT] (NaN gives the lower limit), so the int32 conversion can't overflow
+        constexpr scalar LANE_FLOOR_LIMIT = scalar(1 << 30);
+
+    #ifdef MATH_BATCH_SSE2
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // AoS -> SoA loads
+
+        // 4 x vector2f = 2 x __m128: (x0 y0 x1 y1) (x2 y2 x3 y3)
+        inline void loadTransposed(const vector2f *p, __m128 &x, __m128 &y) {
+            __m128 a = _mm_loadu_ps(p[0].flat2);
+            __m128 b = _mm_loadu_ps(p[2].flat2);
+            x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        }
+
+        // 4 x vector3f = 3 x __m128: (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3)
+        inline void loadTransposed(const vector3f *p, __m128 &x, __m128 &y, __m128 &z) {
+            const scalar *flat = p[0].flat3;
+            __m128 a = _mm_loadu_ps(flat + 0);
+            __m128 b = _mm_loadu_ps(flat + 4);
+            __m128 c = _mm_loadu_ps(flat + 8);
+            x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+            y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+            z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+        }
+
+        // inverse of loadTransposed
+        inline void storeTransposed(vector3f *p, __m128 x, __m128 y, __m128 z) {
+            scalar *flat = p[0].flat3;
+            __m128 a = _mm_shuffle_ps(_mm_unpacklo_ps(x, y), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+            __m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+            _mm_storeu_ps(flat + 0, a);
+            _mm_storeu_ps(flat + 4, b);
+            _mm_storeu_ps(flat + 8, c);
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // normalization
+
+        // 1 / sqrt(lengthSq) per lane, 1 where the length is not above epsilon so such vectors stay as they are (like normalized()).
+        // Fast mode refines rsqrtps (12 bits) with one Newton-Raphson step to ~22 bits, exact mode matches the scalar methods bit to bit.
+        inline __m128 normalizeFactor(__m128 lengthSq, bool exact) {
+            __m128 one = _mm_set1_ps(scalar(1.0));
+            __m128 factor, valid;
+
+            if (exact) {
+                __m128 length = _mm_sqrt_ps(lengthSq);
+                valid = _mm_cmpgt_ps(length, _mm_set1_ps(std::numeric_limits<scalar>::epsilon()));
+                factor = _mm_div_ps(one, length);
+            }
+            else {
+                __m128 y = _mm_rsqrt_ps(lengthSq);
+                __m128 halfLengthSq = _mm_mul_ps(_mm_set1_ps(scalar(0.5)), lengthSq);
+                valid = _mm_cmpgt_ps(lengthSq, _mm_set1_ps(std::numeric_limits<scalar>::epsilon() * std::numeric_limits<scalar>::epsilon()));
+                factor = _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(scalar(1.5)), _mm_mul_ps(halfLengthSq, _mm_mul_ps(y, y))));
+            }
+
+            return _mm_or_ps(_mm_and_ps(valid, factor), _mm_andnot_ps(valid, one));
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // horizontal reductions
+
+        inline scalar horizontalMin(__m128 v) {
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            return _mm_cvtss_f32(v);
+        }
+
+        inline scalar horizontalMax(__m128 v) {
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            return _mm_cvtss_f32(v);
+        }
+
+        // keeps per lane the best value and its index, 'better' is a lane mask where the candidate wins
+        inline void selectBest(__m128 better, __m128 candidate, __m128i index, __m128 &best, __m128i &bestIndex) {
+            __m128i mask = _mm_castps_si128(better);
+            best = _mm_or_ps(_mm_and_ps(better, candidate), _mm_andnot_ps(better, best));
+            bestIndex = _mm_or_si128(_mm_and_si128(mask, index), _mm_andnot_si128(mask, bestIndex));
+        }
+
+        // lane with the smallest value (or the largest when Greater), lowest index on ties
+        template <bool Greater> inline void reduceBest(__m128 best, __m128i bestIndex, scalar &value, std::size_t &index) {
+            alignas(16) scalar values[4];
+            alignas(16) std::int32_t indices[4];
+            _mm_store_ps(values, best);
+            _mm_store_si128(reinterpret_cast<__m128i *>(indices), bestIndex);
+
+            for (int i = 0; i < 4; i++) {
+                bool better = Greater ? values[i] > value : values[i] < value;
+                if (better || (values[i] == value && std::size_t(indices[i]) < index)) {
+                    value = values[i];
+                    index = std::size_t(indices[i]);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // Arvo bound transform with matrix rows loaded once, same operation order as bound2f/bound3f::transformed()
+
+        // rows (_11 _12 _13 _14) ... (_41 _42 _43 _44), abs rows are the first three without sign bits
+        struct boundMatrix3 {
+            __m128 rows[4];
+            __m128 absRows[3];
+
+            explicit boundMatrix3(const transform3f &m) {
+                __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+                for (int i = 0; i < 4; i++) {
+                    rows[i] = _mm_loadu_ps(m.flat16 + 4 * i);
+                }
+                for (int i = 0; i < 3; i++) {
+                    absRows[i] = _mm_and_ps(rows[i], signMask);
+                }
+            }
+        };
+
+        // rows of the 2x2 part and translation doubled as (_11 _12 _11 _12), so one register holds min and max corners
+        struct boundMatrix2 {
+            __m128 rows[3];
+            __m128 absRows[2];
+
+            explicit boundMatrix2(const transform2f &m) {
+                rows[0] = _mm_setr_ps(m._11, m._12, m._11, m._12);
+                rows[1] = _mm_setr_ps(m._21, m._22, m._21, m._22);
+                rows[2] = _mm_setr_ps(m._31, m._32, m._31, m._32);
+                absRows[0] = _mm_setr_ps(std::abs(m._11), std::abs(m._12), std::abs(m._11), std::abs(m._12));
+                absRows[1] = _mm_setr_ps(std::abs(m._21), std::abs(m._22), std::abs(m._21), std::abs(m._22));
+            }
+        };
+
+        inline bound3f boundTransformed(const bound3f &b, const boundMatrix3 &m) {
+            if (b.isEmpty()) {
+                return b;
+            }
+
+            // (xmin ymin zmin xmax) and (zmin xmax ymax zmax) overlap inside one bound3f, so both loads stay in bounds
+            __m128 half = _mm_set1_ps(scalar(0.5));
+            __m128 lo = _mm_loadu_ps(&b.xmin);
+            __m128 hi = _mm_loadu_ps(&b.zmin);
+            hi = _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(3, 3, 2, 1));
+
+            __m128 c = _mm_mul_ps(half, _mm_add_ps(lo, hi));
+            __m128 e = _mm_mul_ps(half, _mm_sub_ps(hi, lo));
+            __m128 cx = _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0)), cy = _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)), cz = _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2));
+            __m128 ex = _mm_shuffle_ps(e, e, _MM_SHUFFLE(0, 0, 0, 0)), ey = _mm_shuffle_ps(e, e, _MM_SHUFFLE(1, 1, 1, 1)), ez = _mm_shuffle_ps(e, e, _MM_SHUFFLE(2, 2, 2, 2));
+
+            c = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, m.rows[0]), _mm_mul_ps(cy, m.rows[1])), _mm_mul_ps(cz, m.rows[2])), m.rows[3]);
+            e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, m.absRows[0]), _mm_mul_ps(ey, m.absRows[1])), _mm_mul_ps(ez, m.absRows[2]));
+
+            alignas(16) scalar rmin[4], rmax[4];
+            _mm_store_ps(rmin, _mm_sub_ps(c, e));
+            _mm_store_ps(rmax, _mm_add_ps(c, e));
+            return {rmin[0], rmin[1], rmin[2], rmax[0], rmax[1], rmax[2]};
+        }
+
+        inline bound2f boundTransformed(const bound2f &b, const boundMatrix2 &m) {
+            if (b.isEmpty()) {
+                return b;
+            }
+
+            // (xmin ymin xmax ymax) + (xmax ymax xmin ymin) gives doubled center, the difference gives extent as (ex ey -ex -ey)
+            __m128 half = _mm_set1_ps(scalar(0.5));
+            __m128 v = _mm_loadu_ps(&b.xmin);
+            __m128 swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+            __m128 c = _mm_mul_ps(half, _mm_add_ps(v, swapped));
+            __m128 e = _mm_mul_ps(half, _mm_sub_ps(swapped, v));
+            __m128 cx = _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0)), cy = _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1));
+            __m128 ex = _mm_shuffle_ps(e, e, _MM_SHUFFLE(0, 0, 0, 0)), ey = _mm_shuffle_ps(e, e, _MM_SHUFFLE(1, 1, 1, 1));
+            __m128 minSigns = _mm_setr_ps(scalar(-0.0), scalar(-0.0), scalar(0.0), scalar(0.0));
+
+            c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, m.rows[0]), _mm_mul_ps(cy, m.rows[1])), m.rows[2]);
+            e = _mm_add_ps(_mm_mul_ps(ex, m.absRows[0]), _mm_mul_ps(ey, m.absRows[1]));
+
+            alignas(16) scalar r[4];
+            _mm_store_ps(r, _mm_add_ps(c, _mm_xor_ps(e, minSigns)));
+            return {r[0], r[1], r[2], r[3]};
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // 8 lanes as a pair of SSE2 registers, for kernels written once as templates over scalar and lane types.
+        // Comparisons give all-ones lanes, laneSelect() takes any nonzero lane as true.
+
+        struct floatx8 {
+            __m128 lo, hi;
+
+            floatx8() = default;
+            floatx8(__m128 lo, __m128 hi) : lo(lo), hi(hi) {}
+            floatx8(scalar s) : lo(_mm_set1_ps(s)), hi(lo) {}
+
+            static floatx8 load(const scalar *p) {
+                return {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)};
+            }
+            void store(scalar *p) const {
+                _mm_storeu_ps(p, lo);
+                _mm_storeu_ps(p + 4, hi);
+            }
+        };
+
+        // 32-bit unsigned lanes, comparisons are signed and valid below 2^31
+        struct uintx8 {
+            __m128i lo, hi;
+
+            uintx8() = default;
+            uintx8(__m128i lo, __m128i hi) : lo(lo), hi(hi) {}
+            uintx8(std::uint32_t s) : lo(_mm_set1_epi32(std::int32_t(s))), hi(lo) {}
+        };
+
+        inline floatx8 operator +(const floatx8 &a, const floatx8 &b) { return {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)}; }
+        inline floatx8 operator -(const floatx8 &a, const floatx8 &b) { return {_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)}; }
+        inline floatx8 operator *(const floatx8 &a, const floatx8 &b) { return {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)}; }
+        inline floatx8 operator /(const floatx8 &a, const floatx8 &b) { return {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)}; }
+        inline floatx8 operator <(const floatx8 &a, const floatx8 &b) { return {_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)}; }
+        inline floatx8 operator >(const floatx8 &a, const floatx8 &b) { return {_mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi)}; }
+        inline floatx8 operator <=(const floatx8 &a, const floatx8 &b) { return {_mm_cmple_ps(a.lo, b.lo), _mm_cmple_ps(a.hi, b.hi)}; }
+        inline floatx8 operator >=(const floatx8 &a, const floatx8 &b) { return {_mm_cmpge_ps(a.lo, b.lo), _mm_cmpge_ps(a.hi, b.hi)}; }
+        inline floatx8 operator ==(const floatx8 &a, const floatx8 &b) { return {_mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi)}; }
+
+        inline __m128i mullo(__m128i a, __m128i b) {
+            __m128i even = _mm_mul_epu32(a, b);
+            __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        }
+
+        inline uintx8 operator +(const uintx8 &a, const uintx8 &b) { return {_mm_add_epi32(a.lo, b.lo), _mm_add_epi32(a.hi, b.hi)}; }
+        inline uintx8 operator -(const uintx8 &a, const uintx8 &b) { return {_mm_sub_epi32(a.lo, b.lo), _mm_sub_epi32(a.hi, b.hi)}; }
+        inline uintx8 operator *(const uintx8 &a, const uintx8 &b) { return {mullo(a.lo, b.lo), mullo(a.hi, b.hi)}; }
+        inline uintx8 operator ^(const uintx8 &a, const uintx8 &b) { return {_mm_xor_si128(a.lo, b.lo), _mm_xor_si128(a.hi, b.hi)}; }
+        inline uintx8 operator &(const uintx8 &a, const uintx8 &b) { return {_mm_and_si128(a.lo, b.lo), _mm_and_si128(a.hi, b.hi)}; }
+        inline uintx8 operator >>(const uintx8 &a, int n) { return {_mm_srli_epi32(a.lo, n), _mm_srli_epi32(a.hi, n)}; }
+        inline uintx8 operator <(const uintx8 &a, const uintx8 &b) { return {_mm_cmplt_epi32(a.lo, b.lo), _mm_cmplt_epi32(a.hi, b.hi)}; }
+        inline uintx8 operator ==(const uintx8 &a, const uintx8 &b) { return {_mm_cmpeq_epi32(a.lo, b.lo), _mm_cmpeq_epi32(a.hi, b.hi)}; }
+
+        inline floatx8 laneSelect(const floatx8 &mask, const floatx8 &a, const floatx8 &b) {
+            return {_mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)), _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi))};
+        }
+        inline floatx8 laneSelect(const uintx8 &condition, const floatx8 &a, const floatx8 &b) {
+            __m128 zlo = _mm_castsi128_ps(_mm_cmpeq_epi32(condition.lo, _mm_setzero_si128()));
+            __m128 zhi = _mm_castsi128_ps(_mm_cmpeq_epi32(condition.hi, _mm_setzero_si128()));
+            return laneSelect(floatx8(zlo, zhi), b, a);
+        }
+
+        inline floatx8 laneMin(const floatx8 &a, const floatx8 &b) { return {_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)}; }
+        inline floatx8 laneMax(const floatx8 &a, const floatx8 &b) { return {_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)}; }
+
+        // logic over comparison masks
+        inline floatx8 laneAnd(const floatx8 &a, const floatx8 &b) { return {_mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi)}; }
+        inline floatx8 laneOr(const floatx8 &a, const floatx8 &b) { return {_mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi)}; }
+        inline floatx8 laneXor(const floatx8 &a, const floatx8 &b) { return {_mm_xor_ps(a.lo, b.lo), _mm_xor_ps(a.hi, b.hi)}; }
+        inline bool laneAny(const floatx8 &mask) {
+            return _mm_movemask_ps(_mm_or_ps(mask.lo, mask.hi)) != 0;
+        }
+        // 8 bytes of 0 / 1
+        inline void laneStore(const floatx8 &mask, std::uint8_t *result) {
+            __m128i one = _mm_set1_epi32(1);
+            __m128i lo = _mm_and_si128(_mm_castps_si128(mask.lo), one), hi = _mm_and_si128(_mm_castps_si128(mask.hi), one);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(result), _mm_packus_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128()));
+        }
+
+        // rounds toward minus infinity, see LANE_FLOOR_LIMIT
+        inline uintx8 laneFloor(const floatx8 &v) {
+            __m128 limit = _mm_set1_ps(LANE_FLOOR_LIMIT), negLimit = _mm_set1_ps(-LANE_FLOOR_LIMIT);
+            __m128 vlo = _mm_min_ps(_mm_max_ps(v.lo, negLimit), limit), vhi = _mm_min_ps(_mm_max_ps(v.hi, negLimit), limit);
+            __m128i lo = _mm_cvttps_epi32(vlo), hi = _mm_cvttps_epi32(vhi);
+            lo = _mm_add_epi32(lo, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(lo), vlo)));
+            hi = _mm_add_epi32(hi, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(hi), vhi)));
+            return {lo, hi};
+        }
+        // lanes as signed integers
+        inline floatx8 laneFloat(const uintx8 &v) {
+            return {_mm_cvtepi32_ps(v.lo), _mm_cvtepi32_ps(v.hi)};
+        }
+        // 1 for true lanes of a comparison
+        inline uintx8 laneBit(const uintx8 &mask) {
+            return mask & uintx8(1);
+        }
+        inline uintx8 laneBit(const floatx8 &mask) {
+            return laneBit(uintx8(_mm_castps_si128(mask.lo), _mm_castps_si128(mask.hi)));
+        }
+    #endif
+
+        // scalar counterparts of the lane operations
+        inline scalar laneSelect(bool condition, scalar a, scalar b) {
+            return condition ? a : b;
+        }
+        inline std::uint32_t laneFloor(scalar v) {
+            v = v > -LANE_FLOOR_LIMIT ? v : -LANE_FLOOR_LIMIT;  // comparison order of maxps/minps, NaN clamps the same way
+            v = v < LANE_FLOOR_LIMIT ? v : LANE_FLOOR_LIMIT;
+            std::int32_t i = std::int32_t(v);
+            return std::uint32_t(i - std::int32_t(scalar(i) > v));
+        }
+        inline scalar laneFloat(std::uint32_t v) {
+            return scalar(std::int32_t(v));
+        }
+        inline std::uint32_t laneBit(bool condition) {
+            return condition ? 1 : 0;
+        }
+        inline scalar laneMin(scalar a, scalar b) {
+            return std::min(a, b);
+        }
+        inline scalar laneMax(scalar a, scalar b) {
+            return std::max(a, b);
+        }
+        inline bool laneAnd(bool a, bool b) {
+            return a && b;
+        }
+        inline bool laneOr(bool a, bool b) {
+            return a || b;
+        }
+        inline bool laneXor(bool a, bool b) {
+            return a != b;
+        }
+        inline bool laneAny(bool mask) {
+            return mask;
+        }
+        inline void laneStore(bool mask, std::uint8_t *result) {
+            *result = mask ? 1 : 0;
+        }
+
+        // Clip planes of viewProjection as (a, b, c, d) with a * x + b * y + c * z + d >= 0 inside: left, right, bottom, top, near, far.
+        // Same clip volume as batch::project(), planes are not normalized.
+        inline void frustumPlanes(const transform3f &m, vector4f (&planes)[6]) {
+            vector4f x = {m._11, m._21, m._31, m._41};
+            vector4f y = {m._12, m._22, m._32, m._42};
+            vector4f z = {m._13, m._23, m._33, m._43};
+            vector4f w = {m._14, m._24, m._34, m._44};
+
+            planes[0] = w + x;
+            planes[1] = w - x;
+            planes[2] = w + y;
+            planes[3] = w - y;
+            planes[4] = w - z;
+            planes[5] = z;
+        }
+
+        // false if bound is entirely outside of some plane, the farthest corner along the plane normal is tested
+        inline bool boundInFrustum(const bound3f &b, const vector4f (&planes)[6]) {
+            scalar cx = (b.xmin + b.xmax) * scalar(0.5), ex = (b.xmax - b.xmin) * scalar(0.5);
+            scalar cy = (b.ymin + b.ymax) * scalar(0.5), ey = (b.ymax - b.ymin) * scalar(0.5);
+            scalar cz = (b.zmin + b.zmax) * scalar(0.5), ez = (b.zmax - b.zmin) * scalar(0.5);
+
+            for (const vector4f &p : planes) {
+                scalar distance = p.x * cx + p.y * cy + p.z * cz + p.w;
+                scalar radius = std::abs(p.x) * ex + std::abs(p.y) * ey + std::abs(p.z) * ez;
+
+                if (distance + radius < scalar(0.0)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // scalar path of batch::project
+        inline bool projectPoint(const vector3f &p, const transform3f &viewProjection, const vector2f &scale, const vector2f &offset, vector2f &screen, scalar &depth) {
+            vector4f c = vector4f(p.x, p.y, p.z, scalar(1.0)).transformed(viewProjection);
+
+            if (c.w > scalar(0.0) && -c.w <= c.x && c.x <= c.w && -c.w <= c.y && c.y <= c.w && scalar(0.0) <= c.z && c.z <= c.w) {
+                scalar inv = scalar(1.0) / c.w;
+                screen = {c.x * inv * scale.x + offset.x, c.y * inv * scale.y + offset.y};
+                depth = c.z * inv;
+                return true;
+            }
+
+            return false;
+        }
+    }
+
+    namespace batch {
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // bounds
+
+        // Bound of 'count' points. For count == 0 result is bound3f::empty() / bound2f::empty().
+
+        inline bound2f boundOf(const vector2f *points, std::size_t count) {
+            scalar xmin = std::numeric_limits<scalar>::max(), ymin = xmin;
+            scalar xmax = -std::numeric_limits<scalar>::max(), ymax = xmax;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            if (count >= 4) {
+                __m128 vxmin = _mm_set1_ps(xmin), vymin = vxmin;
+                __m128 vxmax = _mm_set1_ps(xmax), vymax = vxmax;
+
+                for (; i + 4 <= count; i += 4) {
+                    __m128 x, y;
+                    imp::loadTransposed(points + i, x, y);
+                    vxmin = _mm_min_ps(vxmin, x);
+                    vymin = _mm_min_ps(vymin, y);
+                    vxmax = _mm_max_ps(vxmax, x);
+                    vymax = _mm_max_ps(vymax, y);
+                }
+
+                xmin = imp::horizontalMin(vxmin);
+                ymin = imp::horizontalMin(vymin);
+                xmax = imp::horizontalMax(vxmax);
+                ymax = imp::horizontalMax(vymax);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                xmin = std::min(xmin, points[i].x);
+                ymin = std::min(ymin, points[i].y);
+                xmax = std::max(xmax, points[i].x);
+                ymax = std::max(ymax, points[i].y);
+            }
+
+            return {xmin, ymin, xmax, ymax};
+        }
+
+        inline bound3f boundOf(const vector3f *points, std::size_t count) {
+            scalar xmin = std::numeric_limits<scalar>::max(), ymin = xmin, zmin = xmin;
+            scalar xmax = -std::numeric_limits<scalar>::max(), ymax = xmax, zmax = xmax;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            if (count >= 4) {
+                __m128 vxmin = _mm_set1_ps(xmin), vymin = vxmin, vzmin = vxmin;
+                __m128 vxmax = _mm_set1_ps(xmax), vymax = vxmax, vzmax = vxmax;
+
+                for (; i + 4 <= count; i += 4) {
+                    __m128 x, y, z;
+                    imp::loadTransposed(points + i, x, y, z);
+                    vxmin = _mm_min_ps(vxmin, x);
+                    vymin = _mm_min_ps(vymin, y);
+                    vzmin = _mm_min_ps(vzmin, z);
+                    vxmax = _mm_max_ps(vxmax, x);
+                    vymax = _mm_max_ps(vymax, y);
+                    vzmax = _mm_max_ps(vzmax, z);
+                }
+
+                xmin = imp::horizontalMin(vxmin);
+                ymin = imp::horizontalMin(vymin);
+                zmin = imp::horizontalMin(vzmin);
+                xmax = imp::horizontalMax(vxmax);
+                ymax = imp::horizontalMax(vymax);
+                zmax = imp::horizontalMax(vzmax);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                xmin = std::min(xmin, points[i].x);
+                ymin = std::min(ymin, points[i].y);
+                zmin = std::min(zmin, points[i].z);
+                xmax = std::max(xmax, points[i].x);
+                ymax = std::max(ymax, points[i].y);
+                zmax = std::max(zmax, points[i].z);
+            }
+
+            return {xmin, ymin, zmin, xmax, ymax, zmax};
+        }
+
+        // Union of 'count' bounds, empty() for count == 0
+        inline bound3f merged(const bound3f *bounds, std::size_t count) {
+            bound3f result = bound3f::empty();
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            if (count) {
+                // (xmin ymin zmin xmax) and (zmin xmax ymax zmax) overlap inside one bound3f, so both loads stay in bounds
+                __m128 vmin = _mm_loadu_ps(&bounds[0].xmin);
+                __m128 vmax = _mm_loadu_ps(&bounds[0].zmin);
+
+                for (i = 1; i < count; i++) {
+                    vmin = _mm_min_ps(vmin, _mm_loadu_ps(&bounds[i].xmin));
+                    vmax = _mm_max_ps(vmax, _mm_loadu_ps(&bounds[i].zmin));
+                }
+
+                alignas(16) scalar lo[4], hi[4];
+                _mm_store_ps(lo, vmin);
+                _mm_store_ps(hi, vmax);
+                result = {lo[0], lo[1], lo[2], hi[1], hi[2], hi[3]};
+            }
+        #endif
+
+            for (; i < count; i++) {
+                result = result.merged(bounds[i]);
+            }
+
+            return result;
+        }
+
+        // Arvo transform of every bound by its own matrix: result[i] = bounds[i].transformed(trfms[i]). 'result' may be equal to 'bounds'.
+        inline void transform(const bound3f *bounds, const transform3f *trfms, bound3f *result, std::size_t count) {
+            for (std::size_t i = 0; i < count; i++) {
+            #ifdef MATH_BATCH_SSE2
+                result[i] = imp::boundTransformed(bounds[i], imp::boundMatrix3(trfms[i]));
+            #else
+                result[i] = bounds[i].transformed(trfms[i]);
+            #endif
+            }
+        }
+
+        // Arvo transform of every bound by one matrix, the matrix is prepared once. 'result' may be equal to 'bounds'.
+        inline void transform(const bound3f *bounds, bound3f *result, std::size_t count, const transform3f &trfm) {
+        #ifdef MATH_BATCH_SSE2
+            imp::boundMatrix3 m (trfm);
+
+            for (std::size_t i = 0; i < count; i++) {
+                result[i] = imp::boundTransformed(bounds[i], m);
+            }
+        #else
+            for (std::size_t i = 0; i < count; i++) {
+                result[i] = bounds[i].transformed(trfm);
+            }
+        #endif
+        }
+
+        // 2D counterparts of the above
+        inline void transform(const bound2f *bounds, const transform2f *trfms, bound2f *result, std::size_t count) {
+            for (std::size_t i = 0; i < count; i++) {
+            #ifdef MATH_BATCH_SSE2
+                result[i] = imp::boundTransformed(bounds[i], imp::boundMatrix2(trfms[i]));
+            #else
+                result[i] = bounds[i].transformed(trfms[i]);
+            #endif
+            }
+        }
+
+        inline void transform(const bound2f *bounds, bound2f *result, std::size_t count, const transform2f &trfm) {
+        #ifdef MATH_BATCH_SSE2
+            imp::boundMatrix2 m (trfm);
+
+            for (std::size_t i = 0; i < count; i++) {
+                result[i] = imp::boundTransformed(bounds[i], m);
+            }
+        #else
+            for (std::size_t i = 0; i < count; i++) {
+                result[i] = bounds[i].transformed(trfm);
+            }
+        #endif
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // transform
+        // Same as vector3f::transformed(trfm, likePosition) for every element. 'result' may be equal to 'points'.
+
+        inline void transform(const vector3f *points, vector3f *result, std::size_t count, const transform3f &trfm, bool likePosition = false) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            scalar w = likePosition ? scalar(1.0) : scalar(0.0);
+            __m128 m11 = _mm_set1_ps(trfm._11), m12 = _mm_set1_ps(trfm._12), m13 = _mm_set1_ps(trfm._13);
+            __m128 m21 = _mm_set1_ps(trfm._21), m22 = _mm_set1_ps(trfm._22), m23 = _mm_set1_ps(trfm._23);
+            __m128 m31 = _mm_set1_ps(trfm._31), m32 = _mm_set1_ps(trfm._32), m33 = _mm_set1_ps(trfm._33);
+            __m128 m41 = _mm_set1_ps(w * trfm._41), m42 = _mm_set1_ps(w * trfm._42), m43 = _mm_set1_ps(w * trfm._43);
+
+            for (; i + 4 <= count; i += 4) {
+                __m128 x, y, z;
+                imp::loadTransposed(points + i, x, y, z);
+                __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m11), _mm_mul_ps(y, m21)), _mm_add_ps(_mm_mul_ps(z, m31), m41));
+                __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m12), _mm_mul_ps(y, m22)), _mm_add_ps(_mm_mul_ps(z, m32), m42));
+                __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m13), _mm_mul_ps(y, m23)), _mm_add_ps(_mm_mul_ps(z, m33), m43));
+                imp::storeTransposed(result + i, rx, ry, rz);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                result[i] = points[i].transformed(trfm, likePosition);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // conversion
+        // trs3f -> transform3f for upload, the only place where TRS chains become matrices
+
+        inline void convert(const trs3f *source, transform3f *result, std::size_t count) {
+            for (std::size_t i = 0; i < count; i++) {
+                result[i] = source[i];
+            }
+        }
+
+        // color -> RGBA8 like color::operator unsigned, channels are truncated and expected in [0, 1]
+        inline void convert(const color *source, std::uint32_t *result, std::size_t count) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            __m128 k = _mm_set1_ps(255.0f);
+            __m128i mask = _mm_set1_epi32(255);
+
+            for (; i + 4 <= count; i += 4) {
+                __m128i c0 = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&source[i + 0].r), k)), mask);
+                __m128i c1 = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&source[i + 1].r), k)), mask);
+                __m128i c2 = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&source[i + 2].r), k)), mask);
+                __m128i c3 = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&source[i + 3].r), k)), mask);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(result + i), _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3)));
+            }
+        #endif
+
+            for (; i < count; i++) {
+                result[i] = source[i];
+            }
+        }
+
+        // RGBA8 -> color like color(unsigned)
+        inline void convert(const std::uint32_t *source, color *result, std::size_t count) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            __m128 k = _mm_set1_ps(255.0f);
+            __m128i zero = _mm_setzero_si128();
+
+            for (; i + 4 <= count; i += 4) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+                __m128i lo = _mm_unpacklo_epi8(bytes, zero), hi = _mm_unpackhi_epi8(bytes, zero);
+                _mm_storeu_ps(&result[i + 0].r, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), k));
+                _mm_storeu_ps(&result[i + 1].r, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), k));
+                _mm_storeu_ps(&result[i + 2].r, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), k));
+                _mm_storeu_ps(&result[i + 3].r, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), k));
+            }
+        #endif
+
+            for (; i < count; i++) {
+                result[i] = color(unsigned(source[i]));
+            }
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // normalization: result[i] = source[i].normalized(), vectors not longer than epsilon are copied as is.
+        // Default mode uses rsqrtps with one Newton step (relative error below 1e-6), 'exact' gives the same bits as the scalar methods.
+        // 'result' may be equal to 'source'.
+
+        inline void normalize(const vector2f *source, vector2f *result, std::size_t count, bool exact = false) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            // two vectors per register, squared lengths are summed pairwise in place
+            for (; i + 2 <= count; i += 2) {
+                __m128 v = _mm_loadu_ps(source[i].flat2);
+                __m128 sq = _mm_mul_ps(v, v);
+                __m128 lengthSq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+                _mm_storeu_ps(result[i].flat2, _mm_mul_ps(v, imp::normalizeFactor(lengthSq, exact)));
+            }
+        #endif
+
+            for (; i < count; i++) {
+                result[i] = source[i].normalized();
+            }
+        }
+
+        inline void normalize(const vector3f *source, vector3f *result, std::size_t count, bool exact = false) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            for (; i + 4 <= count; i += 4) {
+                __m128 x, y, z;
+                imp::loadTransposed(source + i, x, y, z);
+                __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+                __m128 factor = imp::normalizeFactor(lengthSq, exact);
+                imp::storeTransposed(result + i, _mm_mul_ps(x, factor), _mm_mul_ps(y, factor), _mm_mul_ps(z, factor));
+            }
+        #endif
+
+            for (; i < count; i++) {
+                result[i] = source[i].normalized();
+            }
+        }
+
+        // unlike quaternion::normalized() zero quaternions are kept instead of turning into NaN
+        inline void normalize(const quaternion *source, quaternion *result, std::size_t count, bool exact = false) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            for (; i + 4 <= count; i += 4) {
+                __m128 x = _mm_loadu_ps(&source[i + 0].x);
+                __m128 y = _mm_loadu_ps(&source[i + 1].x);
+                __m128 z = _mm_loadu_ps(&source[i + 2].x);
+                __m128 w = _mm_loadu_ps(&source[i + 3].x);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w));
+                __m128 factor = imp::normalizeFactor(lengthSq, exact);
+                x = _mm_mul_ps(x, factor);
+                y = _mm_mul_ps(y, factor);
+                z = _mm_mul_ps(z, factor);
+                w = _mm_mul_ps(w, factor);
+
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+                _mm_storeu_ps(&result[i + 0].x, x);
+                _mm_storeu_ps(&result[i + 1].x, y);
+                _mm_storeu_ps(&result[i + 2].x, z);
+                _mm_storeu_ps(&result[i + 3].x, w);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                const quaternion &q = source[i];
+                scalar lm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+                result[i] = q;
+
+                if (lm > std::numeric_limits<scalar>::epsilon()) {
+                    lm = scalar(1.0) / lm;
+                    result[i] = {lm * q.x, lm * q.y, lm * q.z, lm * q.w};
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // projection: position -> clip space (x, y, z, w) = (p, 1) * viewProjection -> frustum test -> perspective divide -> viewport.
+        // Visible means -w <= x <= w, -w <= y <= w, 0 <= z <= w and w > 0 (depth range of perspectiveFovRH/LH).
+        // Screen y grows down: ndc y = 1 goes to viewport.ymin. Depth is ndc z = z / w.
+
+        // Writes screen position, depth and source index of every visible point packed from the start of the buffers.
+        // Returns number of visible points. 'indices' may be null.
+        inline std::size_t project(const vector3f *points, std::size_t count, const transform3f &viewProjection, const bound2f &viewport, vector2f *screen, scalar *depth, std::uint32_t *indices = nullptr) {
+            vector2f scale = {scalar(0.5) * (viewport.xmax - viewport.xmin), scalar(-0.5) * (viewport.ymax - viewport.ymin)};
+            vector2f offset = viewport.center();
+            std::size_t visible = 0;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            const transform3f &m = viewProjection;
+            __m128 m11 = _mm_set1_ps(m._11), m12 = _mm_set1_ps(m._12), m13 = _mm_set1_ps(m._13), m14 = _mm_set1_ps(m._14);
+            __m128 m21 = _mm_set1_ps(m._21), m22 = _mm_set1_ps(m._22), m23 = _mm_set1_ps(m._23), m24 = _mm_set1_ps(m._24);
+            __m128 m31 = _mm_set1_ps(m._31), m32 = _mm_set1_ps(m._32), m33 = _mm_set1_ps(m._33), m34 = _mm_set1_ps(m._34);
+            __m128 m41 = _mm_set1_ps(m._41), m42 = _mm_set1_ps(m._42), m43 = _mm_set1_ps(m._43), m44 = _mm_set1_ps(m._44);
+            __m128 sx = _mm_set1_ps(scale.x), sy = _mm_set1_ps(scale.y);
+            __m128 ox = _mm_set1_ps(offset.x), oy = _mm_set1_ps(offset.y);
+            __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(scalar(1.0));
+
+            for (; i + 4 <= count; i += 4) {
+                __m128 x, y, z;
+                imp::loadTransposed(points + i, x, y, z);
+
+                // same operation order as vector4f::transformed with w = 1
+                __m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m11), _mm_mul_ps(y, m21)), _mm_mul_ps(z, m31)), m41);
+                __m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m12), _mm_mul_ps(y, m22)), _mm_mul_ps(z, m32)), m42);
+                __m128 cz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m13), _mm_mul_ps(y, m23)), _mm_mul_ps(z, m33)), m43);
+                __m128 cw = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m14), _mm_mul_ps(y, m24)), _mm_mul_ps(z, m34)), m44);
+                __m128 negw = _mm_sub_ps(zero, cw);
+
+                __m128 inside = _mm_and_ps(_mm_cmpgt_ps(cw, zero), _mm_and_ps(_mm_cmple_ps(negw, cx), _mm_cmple_ps(cx, cw)));
+                inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmple_ps(negw, cy), _mm_cmple_ps(cy, cw)));
+                inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmple_ps(zero, cz), _mm_cmple_ps(cz, cw)));
+                int mask = _mm_movemask_ps(inside);
+
+                if (mask) {
+                    __m128 inv = _mm_div_ps(one, cw);
+                    alignas(16) scalar px[4], py[4], pz[4];
+                    _mm_store_ps(px, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cx, inv), sx), ox));
+                    _mm_store_ps(py, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cy, inv), sy), oy));
+                    _mm_store_ps(pz, _mm_mul_ps(cz, inv));
+
+                    for (int lane = 0; lane < 4; lane++) {
+                        if (mask & (1 << lane)) {
+                            screen[visible] = {px[lane], py[lane]};
+                            depth[visible] = pz[lane];
+
+                            if (indices) {
+                                indices[visible] = std::uint32_t(i + lane);
+                            }
+
+                            visible++;
+                        }
+                    }
+                }
+            }
+        #endif
+
+            for (; i < count; i++) {
+                if (imp::projectPoint(points[i], viewProjection, scale, offset, screen[visible], depth[visible])) {
+                    if (indices) {
+                        indices[visible] = std::uint32_t(i);
+                    }
+
+                    visible++;
+                }
+            }
+
+            return visible;
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // frustum culling against the clip planes of viewProjection (imp::frustumPlanes). Conservative: bounds near the frustum
+        // edges may be kept while being outside.
+
+        // Writes indices of kept bounds in increasing order, returns their number
+        inline std::size_t cull(const bound3f *bounds, std::size_t count, const transform3f &viewProjection, std::uint32_t *visibleIndices) {
+            vector4f planes[6];
+            std::size_t visible = 0;
+            std::size_t i = 0;
+
+            imp::frustumPlanes(viewProjection, planes);
+
+        #ifdef MATH_BATCH_SSE2
+            __m128 half = _mm_set1_ps(scalar(0.5)), zero = _mm_setzero_ps();
+            __m128 sign = _mm_set1_ps(-0.0f);
+
+            for (; i + 4 <= count; i += 4) {
+                const bound3f *b = bounds + i;
+                __m128 xmin = _mm_setr_ps(b[0].xmin, b[1].xmin, b[2].xmin, b[3].xmin), xmax = _mm_setr_ps(b[0].xmax, b[1].xmax, b[2].xmax, b[3].xmax);
+                __m128 ymin = _mm_setr_ps(b[0].ymin, b[1].ymin, b[2].ymin, b[3].ymin), ymax = _mm_setr_ps(b[0].ymax, b[1].ymax, b[2].ymax, b[3].ymax);
+                __m128 zmin = _mm_setr_ps(b[0].zmin, b[1].zmin, b[2].zmin, b[3].zmin), zmax = _mm_setr_ps(b[0].zmax, b[1].zmax, b[2].zmax, b[3].zmax);
+                __m128 cx = _mm_mul_ps(_mm_add_ps(xmin, xmax), half), ex = _mm_mul_ps(_mm_sub_ps(xmax, xmin), half);
+                __m128 cy = _mm_mul_ps(_mm_add_ps(ymin, ymax), half), ey = _mm_mul_ps(_mm_sub_ps(ymax, ymin), half);
+                __m128 cz = _mm_mul_ps(_mm_add_ps(zmin, zmax), half), ez = _mm_mul_ps(_mm_sub_ps(zmax, zmin), half);
+                __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+                for (const vector4f &p : planes) {
+                    __m128 px = _mm_set1_ps(p.x), py = _mm_set1_ps(p.y), pz = _mm_set1_ps(p.z);
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)), _mm_mul_ps(pz, cz)), _mm_set1_ps(p.w));
+                    __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign, px), ex), _mm_mul_ps(_mm_andnot_ps(sign, py), ey)), _mm_mul_ps(_mm_andnot_ps(sign, pz), ez));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+                }
+
+                for (int mask = _mm_movemask_ps(inside), lane = 0; lane < 4; lane++) {
+                    if (mask & (1 << lane)) {
+                        visibleIndices[visible++] = std::uint32_t(i + lane);
+                    }
+                }
+            }
+        #endif
+
+            for (; i < count; i++) {
+                if (imp::boundInFrustum(bounds[i], planes)) {
+                    visibleIndices[visible++] = std::uint32_t(i);
+                }
+            }
+
+            return visible;
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // orientation integration over SoA arrays (qx, qy, qz, qw) and world space angular velocities (wx, wy, wz) in radians per second.
+        // Velocity w turns like quaternion(w / |w|, |w| * dt) appended to the orientation, so one step is the first-order
+        // q += q * (-w * dt / 2, 0) without sin/cos. The step makes quaternions slightly longer ((|w| * dt / 2)^2 per step),
+        // so pass 'renormalize' every few ticks, or every tick when |w| * dt is large.
+
+        inline void integrateOrientations(scalar *qx, scalar *qy, scalar *qz, scalar *qw, const scalar *wx, const scalar *wy, const scalar *wz, std::size_t count, scalar dt, bool renormalize) {
+            scalar k = scalar(-0.5) * dt;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            __m128 kk = _mm_set1_ps(k);
+
+            for (; i + 4 <= count; i += 4) {
+                __m128 x = _mm_loadu_ps(qx + i), y = _mm_loadu_ps(qy + i), z = _mm_loadu_ps(qz + i), w = _mm_loadu_ps(qw + i);
+                __m128 ox = _mm_mul_ps(_mm_loadu_ps(wx + i), kk);
+                __m128 oy = _mm_mul_ps(_mm_loadu_ps(wy + i), kk);
+                __m128 oz = _mm_mul_ps(_mm_loadu_ps(wz + i), kk);
+
+                __m128 rx = _mm_add_ps(x, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(oy, z), _mm_mul_ps(oz, y)), _mm_mul_ps(ox, w)));
+                __m128 ry = _mm_add_ps(y, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(oz, x), _mm_mul_ps(ox, z)), _mm_mul_ps(oy, w)));
+                __m128 rz = _mm_add_ps(z, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ox, y), _mm_mul_ps(oy, x)), _mm_mul_ps(oz, w)));
+                __m128 rw = _mm_sub_ps(w, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, x), _mm_mul_ps(oy, y)), _mm_mul_ps(oz, z)));
+
+                if (renormalize) {
+                    __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz)), _mm_mul_ps(rw, rw));
+                    __m128 factor = imp::normalizeFactor(lengthSq, false);
+                    rx = _mm_mul_ps(rx, factor);
+                    ry = _mm_mul_ps(ry, factor);
+                    rz = _mm_mul_ps(rz, factor);
+                    rw = _mm_mul_ps(rw, factor);
+                }
+
+                _mm_storeu_ps(qx + i, rx);
+                _mm_storeu_ps(qy + i, ry);
+                _mm_storeu_ps(qz + i, rz);
+                _mm_storeu_ps(qw + i, rw);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                scalar ox = wx[i] * k, oy = wy[i] * k, oz = wz[i] * k;
+                scalar x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+
+                // q * (ox, oy, oz, 0) as in quaternion::operator *
+                quaternion r = {
+                    x + ((oy * z - oz * y) + ox * w),
+                    y + ((oz * x - ox * z) + oy * w),
+                    z + ((ox * y - oy * x) + oz * w),
+                    w - ((ox * x + oy * y) + oz * z),
+                };
+
+                if (renormalize) {
+                    scalar lengthSq = r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w;
+                    r = lengthSq > std::numeric_limits<scalar>::epsilon() * std::numeric_limits<scalar>::epsilon() ? r.normalized() : r;
+                }
+
+                qx[i] = r.x;
+                qy[i] = r.y;
+                qz[i] = r.z;
+                qw[i] = r.w;
+            }
+        }
+
+        // result[i] = matrix3f(quaternion(qx[i], qy[i], qz[i], qw[i])), quaternions are expected to be unit
+        inline void toMatrices(const scalar *qx, const scalar *qy, const scalar *qz, const scalar *qw, std::size_t count, matrix3f *result) {
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            __m128 one = _mm_set1_ps(scalar(1.0)), two = _mm_set1_ps(scalar(2.0));
+
+            for (; i + 4 <= count; i += 4) {
+                __m128 x = _mm_loadu_ps(qx + i), y = _mm_loadu_ps(qy + i), z = _mm_loadu_ps(qz + i), w = _mm_loadu_ps(qw + i);
+                __m128 x2 = _mm_mul_ps(two, x), y2 = _mm_mul_ps(two, y), z2 = _mm_mul_ps(two, z);
+                __m128 xx = _mm_mul_ps(x2, x), xy = _mm_mul_ps(x2, y), xz = _mm_mul_ps(x2, z);
+                __m128 yy = _mm_mul_ps(y2, y), yz = _mm_mul_ps(y2, z), zz = _mm_mul_ps(z2, z);
+                __m128 wx = _mm_mul_ps(_mm_mul_ps(two, w), x), wy = _mm_mul_ps(_mm_mul_ps(two, w), y), wz = _mm_mul_ps(_mm_mul_ps(two, w), z);
+
+                // element-major, then every matrix gathers its 9 elements
+                alignas(16) scalar m[9][4];
+                _mm_store_ps(m[0], _mm_sub_ps(one, _mm_add_ps(yy, zz)));
+                _mm_store_ps(m[1], _mm_add_ps(xy, wz));
+                _mm_store_ps(m[2], _mm_sub_ps(xz, wy));
+                _mm_store_ps(m[3], _mm_sub_ps(xy, wz));
+                _mm_store_ps(m[4], _mm_sub_ps(one, _mm_add_ps(xx, zz)));
+                _mm_store_ps(m[5], _mm_add_ps(yz, wx));
+                _mm_store_ps(m[6], _mm_add_ps(xz, wy));
+                _mm_store_ps(m[7], _mm_sub_ps(yz, wx));
+                _mm_store_ps(m[8], _mm_sub_ps(one, _mm_add_ps(xx, yy)));
+
+                for (std::size_t lane = 0; lane < 4; lane++) {
+                    for (std::size_t e = 0; e < 9; e++) {
+                        result[i + lane].flat9[e] = m[e][lane];
+                    }
+                }
+            }
+        #endif
+
+            for (; i < count; i++) {
+                result[i] = matrix3f(quaternion(qx[i], qy[i], qz[i], qw[i]));
+            }
+        }
+
+        // World space inverse inertia tensors of bodies with diagonal body space inverse inertia:
+        // result[i] = transposed(rotations[i]) * diagonal(inverseInertia[i]) * rotations[i] (row vectors, body -> world rotations)
+        inline void rotateInertia(const matrix3f *rotations, const vector3f *inverseInertia, std::size_t count, matrix3f *result) {
+            for (std::size_t i = 0; i < count; i++) {
+                const matrix3f &r = rotations[i];
+                const vector3f &d = inverseInertia[i];
+                vector3f a = {r._11 * d.x, r._21 * d.y, r._31 * d.z};
+                vector3f b = {r._12 * d.x, r._22 * d.y, r._32 * d.z};
+                vector3f c = {r._13 * d.x, r._23 * d.y, r._33 * d.z};
+
+                // symmetric, 6 distinct elements
+                scalar m12 = a.x * r._12 + a.y * r._22 + a.z * r._32;
+                scalar m13 = a.x * r._13 + a.y * r._23 + a.z * r._33;
+                scalar m23 = b.x * r._13 + b.y * r._23 + b.z * r._33;
+
+                result[i] = {
+                    a.x * r._11 + a.y * r._21 + a.z * r._31, m12, m13,
+                    m12, b.x * r._12 + b.y * r._22 + b.z * r._32, m23,
+                    m13, m23, c.x * r._13 + c.y * r._23 + c.z * r._33,
+                };
+            }
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // nearest point: argmin of distanceSqTo(query)
+        // Returns index of the first nearest point or 'count' if there are no points. Indices are tracked in 32 bit lanes.
+
+        inline std::size_t nearestIndex(const vector2f *points, std::size_t count, const vector2f &query) {
+            scalar bestValue = std::numeric_limits<scalar>::infinity();
+            std::size_t bestIndex = count;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            if (count >= 4) {
+                __m128 qx = _mm_set1_ps(query.x);
+                __m128 qy = _mm_set1_ps(query.y);
+                __m128 best = _mm_set1_ps(bestValue);
+                __m128i bestLanes = _mm_set1_epi32(std::int32_t(count));
+                __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+                __m128i step = _mm_set1_epi32(4);
+
+                for (; i + 4 <= count; i += 4) {
+                    __m128 x, y;
+                    imp::loadTransposed(points + i, x, y);
+                    __m128 dx = _mm_sub_ps(x, qx);
+                    __m128 dy = _mm_sub_ps(y, qy);
+                    __m128 d = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+                    imp::selectBest(_mm_cmplt_ps(d, best), d, index, best, bestLanes);
+                    index = _mm_add_epi32(index, step);
+                }
+
+                imp::reduceBest<false>(best, bestLanes, bestValue, bestIndex);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                scalar d = points[i].distanceSqTo(query);
+                if (d < bestValue) {
+                    bestValue = d;
+                    bestIndex = i;
+                }
+            }
+
+            return bestIndex;
+        }
+
+        inline std::size_t nearestIndex(const vector3f *points, std::size_t count, const vector3f &query) {
+            scalar bestValue = std::numeric_limits<scalar>::infinity();
+            std::size_t bestIndex = count;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            if (count >= 4) {
+                __m128 qx = _mm_set1_ps(query.x);
+                __m128 qy = _mm_set1_ps(query.y);
+                __m128 qz = _mm_set1_ps(query.z);
+                __m128 best = _mm_set1_ps(bestValue);
+                __m128i bestLanes = _mm_set1_epi32(std::int32_t(count));
+                __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+                __m128i step = _mm_set1_epi32(4);
+
+                for (; i + 4 <= count; i += 4) {
+                    __m128 x, y, z;
+                    imp::loadTransposed(points + i, x, y, z);
+                    __m128 dx = _mm_sub_ps(x, qx);
+                    __m128 dy = _mm_sub_ps(y, qy);
+                    __m128 dz = _mm_sub_ps(z, qz);
+                    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                    imp::selectBest(_mm_cmplt_ps(d, best), d, index, best, bestLanes);
+                    index = _mm_add_epi32(index, step);
+                }
+
+                imp::reduceBest<false>(best, bestLanes, bestValue, bestIndex);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                scalar d = points[i].distanceSqTo(query);
+                if (d < bestValue) {
+                    bestValue = d;
+                    bestIndex = i;
+                }
+            }
+
+            return bestIndex;
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // support point: argmax of dot(direction), the GJK support function
+        // Returns index of the first farthest point along direction or 'count' if there are no points.
+
+        inline std::size_t supportIndex(const vector2f *points, std::size_t count, const vector2f &direction) {
+            scalar bestValue = -std::numeric_limits<scalar>::infinity();
+            std::size_t bestIndex = count;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            if (count >= 4) {
+                __m128 nx = _mm_set1_ps(direction.x);
+                __m128 ny = _mm_set1_ps(direction.y);
+                __m128 best = _mm_set1_ps(bestValue);
+                __m128i bestLanes = _mm_set1_epi32(std::int32_t(count));
+                __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+                __m128i step = _mm_set1_epi32(4);
+
+                for (; i + 4 <= count; i += 4) {
+                    __m128 x, y;
+                    imp::loadTransposed(points + i, x, y);
+                    __m128 d = _mm_add_ps(_mm_mul_ps(x, nx), _mm_mul_ps(y, ny));
+                    imp::selectBest(_mm_cmpgt_ps(d, best), d, index, best, bestLanes);
+                    index = _mm_add_epi32(index, step);
+                }
+
+                imp::reduceBest<true>(best, bestLanes, bestValue, bestIndex);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                scalar d = points[i].dot(direction);
+                if (d > bestValue) {
+                    bestValue = d;
+                    bestIndex = i;
+                }
+            }
+
+            return bestIndex;
+        }
+
+        inline std::size_t supportIndex(const vector3f *points, std::size_t count, const vector3f &direction) {
+            scalar bestValue = -std::numeric_limits<scalar>::infinity();
+            std::size_t bestIndex = count;
+            std::size_t i = 0;
+
+        #ifdef MATH_BATCH_SSE2
+            if (count >= 4) {
+                __m128 nx = _mm_set1_ps(direction.x);
+                __m128 ny = _mm_set1_ps(direction.y);
+                __m128 nz = _mm_set1_ps(direction.z);
+                __m128 best = _mm_set1_ps(bestValue);
+                __m128i bestLanes = _mm_set1_epi32(std::int32_t(count));
+                __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+                __m128i step = _mm_set1_epi32(4);
+
+                for (; i + 4 <= count; i += 4) {
+                    __m128 x, y, z;
+                    imp::loadTransposed(points + i, x, y, z);
+                    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, nx), _mm_mul_ps(y, ny)), _mm_mul_ps(z, nz));
+                    imp::selectBest(_mm_cmpgt_ps(d, best), d, index, best, bestLanes);
+                    index = _mm_add_epi32(index, step);
+                }
+
+                imp::reduceBest<true>(best, bestLanes, bestValue, bestIndex);
+            }
+        #endif
+
+            for (; i < count; i++) {
+                scalar d = points[i].dot(direction);
+                if (d > bestValue) {
+                    bestValue = d;
+                    bestIndex = i;
+                }
+            }
+
+            return bestIndex;
+        }
+    }
+}
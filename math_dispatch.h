@@ -0,0 +1,700 @@
+#pragma once
+
+// Runtime instruction set dispatch for the hot batch kernels of math_batch.h.
+// The binary is built for the SSE2 baseline; AVX2 and AVX-512 kernels are compiled with target attributes and are picked
+// on first use by what the CPU and OS support. Kernels avoid FMA and keep the operation order of the SSE2 ones, so 'exact'
+// normalization, transforms, culling and color conversion give the same bits on every vector instruction set and machine
+// (generic transforms sum the terms in another order). Fast normalization differs in the last bits with AVX-512 rsqrt14.
+// Builds with an FMA baseline (-march=haswell and later) let GCC fuse the SSE2 kernels as well, use -ffp-contract=off there.
+//
+//   dispatch::transform(points, result, count, trfm, true);   // same arguments as batch::transform
+//   dispatch::select(BatchIsa::SSE2);                          // tests: force a kernel set, false if not supported
+
+#include <atomic>
+#include <cstdint>
+#include "math_batch.h"
+
+#if defined(MATH_BATCH_SSE2) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+    #define MATH_DISPATCH_AVX
+    #include <immintrin.h>
+
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define MATH_TARGET_AVX2
+        #define MATH_TARGET_AVX512
+    #elif defined(__clang__)
+        #define MATH_TARGET_AVX2 __attribute__((target("avx2")))
+        #define MATH_TARGET_AVX512 __attribute__((target("avx512f")))
+    #else
+        // GCC fuses multiplications and additions of intrinsics into FMA when the target has it, which changes rounding
+        #define MATH_TARGET_AVX2 __attribute__((target("avx2"), optimize("fp-contract=off")))
+        #define MATH_TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    #endif
+#endif
+
+namespace math
+{
+    enum class BatchIsa {
+        Generic,  // scalar methods of math.h
+        SSE2,     // math_batch.h kernels
+        AVX2,
+        AVX512,
+    };
+
+    namespace imp {
+        struct BatchKernels {
+            void (*transform)(const vector3f *, vector3f *, std::size_t, const transform3f &, bool);
+            void (*normalize2)(const vector2f *, vector2f *, std::size_t, bool);
+            void (*normalize3)(const vector3f *, vector3f *, std::size_t, bool);
+            void (*normalizeQ)(const quaternion *, quaternion *, std::size_t, bool);
+            std::size_t (*cull)(const bound3f *, std::size_t, const transform3f &, std::uint32_t *);
+            void (*toRGBA8)(const color *, std::uint32_t *, std::size_t);
+            void (*fromRGBA8)(const std::uint32_t *, color *, std::size_t);
+        };
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // generic: element by element with the scalar methods
+
+        namespace generic {
+            inline void transform(const vector3f *points, vector3f *result, std::size_t count, const transform3f &trfm, bool likePosition) {
+                for (std::size_t i = 0; i < count; i++) {
+                    result[i] = points[i].transformed(trfm, likePosition);
+                }
+            }
+
+            inline void normalize2(const vector2f *source, vector2f *result, std::size_t count, bool) {
+                for (std::size_t i = 0; i < count; i++) {
+                    result[i] = source[i].normalized();
+                }
+            }
+
+            inline void normalize3(const vector3f *source, vector3f *result, std::size_t count, bool) {
+                for (std::size_t i = 0; i < count; i++) {
+                    result[i] = source[i].normalized();
+                }
+            }
+
+            inline void normalizeQ(const quaternion *source, quaternion *result, std::size_t count, bool) {
+                for (std::size_t i = 0; i < count; i++) {
+                    const quaternion &q = source[i];
+                    scalar lm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+                    result[i] = q;
+
+                    if (lm > std::numeric_limits<scalar>::epsilon()) {
+                        lm = scalar(1.0) / lm;
+                        result[i] = {lm * q.x, lm * q.y, lm * q.z, lm * q.w};
+                    }
+                }
+            }
+
+            inline std::size_t cull(const bound3f *bounds, std::size_t count, const transform3f &viewProjection, std::uint32_t *visibleIndices) {
+                vector4f planes[6];
+                std::size_t visible = 0;
+
+                frustumPlanes(viewProjection, planes);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    if (boundInFrustum(bounds[i], planes)) {
+                        visibleIndices[visible++] = std::uint32_t(i);
+                    }
+                }
+
+                return visible;
+            }
+
+            inline void toRGBA8(const color *source, std::uint32_t *result, std::size_t count) {
+                for (std::size_t i = 0; i < count; i++) {
+                    result[i] = source[i];
+                }
+            }
+
+            inline void fromRGBA8(const std::uint32_t *source, color *result, std::size_t count) {
+                for (std::size_t i = 0; i < count; i++) {
+                    result[i] = color(unsigned(source[i]));
+                }
+            }
+        }
+
+    #ifdef MATH_DISPATCH_AVX
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // AVX2: 8 elements per step, the rest goes to the SSE2 kernel
+
+        namespace avx2 {
+            MATH_TARGET_AVX2 inline __m256 normalizeFactor(__m256 lengthSq, bool exact) {
+                __m256 one = _mm256_set1_ps(scalar(1.0));
+                __m256 factor, valid;
+
+                if (exact) {
+                    __m256 length = _mm256_sqrt_ps(lengthSq);
+                    valid = _mm256_cmp_ps(length, _mm256_set1_ps(std::numeric_limits<scalar>::epsilon()), _CMP_GT_OQ);
+                    factor = _mm256_div_ps(one, length);
+                }
+                else {
+                    __m256 y = _mm256_rsqrt_ps(lengthSq);
+                    __m256 halfLengthSq = _mm256_mul_ps(_mm256_set1_ps(scalar(0.5)), lengthSq);
+                    valid = _mm256_cmp_ps(lengthSq, _mm256_set1_ps(std::numeric_limits<scalar>::epsilon() * std::numeric_limits<scalar>::epsilon()), _CMP_GT_OQ);
+                    factor = _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(scalar(1.5)), _mm256_mul_ps(halfLengthSq, _mm256_mul_ps(y, y))));
+                }
+
+                return _mm256_blendv_ps(one, factor, valid);
+            }
+
+            // 8 x vector3f through two SSE2 transpositions
+            MATH_TARGET_AVX2 inline void loadTransposed(const vector3f *p, __m256 &x, __m256 &y, __m256 &z) {
+                __m128 x0, y0, z0, x1, y1, z1;
+                imp::loadTransposed(p, x0, y0, z0);
+                imp::loadTransposed(p + 4, x1, y1, z1);
+                x = _mm256_set_m128(x1, x0);
+                y = _mm256_set_m128(y1, y0);
+                z = _mm256_set_m128(z1, z0);
+            }
+
+            MATH_TARGET_AVX2 inline void storeTransposed(vector3f *p, __m256 x, __m256 y, __m256 z) {
+                imp::storeTransposed(p, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+                imp::storeTransposed(p + 4, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+            }
+
+            MATH_TARGET_AVX2 inline void transform(const vector3f *points, vector3f *result, std::size_t count, const transform3f &trfm, bool likePosition) {
+                scalar w = likePosition ? scalar(1.0) : scalar(0.0);
+                __m256 m11 = _mm256_set1_ps(trfm._11), m12 = _mm256_set1_ps(trfm._12), m13 = _mm256_set1_ps(trfm._13);
+                __m256 m21 = _mm256_set1_ps(trfm._21), m22 = _mm256_set1_ps(trfm._22), m23 = _mm256_set1_ps(trfm._23);
+                __m256 m31 = _mm256_set1_ps(trfm._31), m32 = _mm256_set1_ps(trfm._32), m33 = _mm256_set1_ps(trfm._33);
+                __m256 m41 = _mm256_set1_ps(w * trfm._41), m42 = _mm256_set1_ps(w * trfm._42), m43 = _mm256_set1_ps(w * trfm._43);
+                std::size_t i = 0;
+
+                for (; i + 8 <= count; i += 8) {
+                    __m256 x, y, z;
+                    loadTransposed(points + i, x, y, z);
+                    __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m11), _mm256_mul_ps(y, m21)), _mm256_add_ps(_mm256_mul_ps(z, m31), m41));
+                    __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m12), _mm256_mul_ps(y, m22)), _mm256_add_ps(_mm256_mul_ps(z, m32), m42));
+                    __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m13), _mm256_mul_ps(y, m23)), _mm256_add_ps(_mm256_mul_ps(z, m33), m43));
+                    storeTransposed(result + i, rx, ry, rz);
+                }
+
+                batch::transform(points + i, result + i, count - i, trfm, likePosition);
+            }
+
+            MATH_TARGET_AVX2 inline void normalize2(const vector2f *source, vector2f *result, std::size_t count, bool exact) {
+                std::size_t i = 0;
+
+                for (; i + 4 <= count; i += 4) {
+                    __m256 v = _mm256_loadu_ps(source[i].flat2);
+                    __m256 sq = _mm256_mul_ps(v, v);
+                    __m256 lengthSq = _mm256_add_ps(sq, _mm256_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+                    _mm256_storeu_ps(result[i].flat2, _mm256_mul_ps(v, normalizeFactor(lengthSq, exact)));
+                }
+
+                batch::normalize(source + i, result + i, count - i, exact);
+            }
+
+            MATH_TARGET_AVX2 inline void normalize3(const vector3f *source, vector3f *result, std::size_t count, bool exact) {
+                std::size_t i = 0;
+
+                for (; i + 8 <= count; i += 8) {
+                    __m256 x, y, z;
+                    loadTransposed(source + i, x, y, z);
+                    __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+                    __m256 factor = normalizeFactor(lengthSq, exact);
+                    storeTransposed(result + i, _mm256_mul_ps(x, factor), _mm256_mul_ps(y, factor), _mm256_mul_ps(z, factor));
+                }
+
+                batch::normalize(source + i, result + i, count - i, exact);
+            }
+
+            // 4x4 transposition inside each 128-bit half, so every register holds one component of 8 quaternions
+            MATH_TARGET_AVX2 inline void transposeHalves(__m256 &a, __m256 &b, __m256 &c, __m256 &d) {
+                __m256 t0 = _mm256_unpacklo_ps(a, b), t1 = _mm256_unpacklo_ps(c, d);
+                __m256 t2 = _mm256_unpackhi_ps(a, b), t3 = _mm256_unpackhi_ps(c, d);
+                a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+                b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+                c = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+                d = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+            }
+
+            MATH_TARGET_AVX2 inline void normalizeQ(const quaternion *source, quaternion *result, std::size_t count, bool exact) {
+                std::size_t i = 0;
+
+                for (; i + 8 <= count; i += 8) {
+                    __m256 x = _mm256_loadu_ps(&source[i + 0].x);
+                    __m256 y = _mm256_loadu_ps(&source[i + 2].x);
+                    __m256 z = _mm256_loadu_ps(&source[i + 4].x);
+                    __m256 w = _mm256_loadu_ps(&source[i + 6].x);
+                    transposeHalves(x, y, z, w);
+
+                    __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)), _mm256_mul_ps(w, w));
+                    __m256 factor = normalizeFactor(lengthSq, exact);
+                    x = _mm256_mul_ps(x, factor);
+                    y = _mm256_mul_ps(y, factor);
+                    z = _mm256_mul_ps(z, factor);
+                    w = _mm256_mul_ps(w, factor);
+
+                    transposeHalves(x, y, z, w);
+                    _mm256_storeu_ps(&result[i + 0].x, x);
+                    _mm256_storeu_ps(&result[i + 2].x, y);
+                    _mm256_storeu_ps(&result[i + 4].x, z);
+                    _mm256_storeu_ps(&result[i + 6].x, w);
+                }
+
+                batch::normalize(source + i, result + i, count - i, exact);
+            }
+
+            MATH_TARGET_AVX2 inline std::size_t cull(const bound3f *bounds, std::size_t count, const transform3f &viewProjection, std::uint32_t *visibleIndices) {
+                vector4f planes[6];
+                std::size_t visible = 0;
+                std::size_t i = 0;
+
+                frustumPlanes(viewProjection, planes);
+
+                __m256 half = _mm256_set1_ps(scalar(0.5)), zero = _mm256_setzero_ps(), sign = _mm256_set1_ps(-0.0f);
+                __m256i stride = _mm256_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42);
+
+                for (; i + 8 <= count; i += 8) {
+                    const scalar *flat = &bounds[i].xmin;
+                    __m256 xmin = _mm256_i32gather_ps(flat + 0, stride, 4), xmax = _mm256_i32gather_ps(flat + 3, stride, 4);
+                    __m256 ymin = _mm256_i32gather_ps(flat + 1, stride, 4), ymax = _mm256_i32gather_ps(flat + 4, stride, 4);
+                    __m256 zmin = _mm256_i32gather_ps(flat + 2, stride, 4), zmax = _mm256_i32gather_ps(flat + 5, stride, 4);
+                    __m256 cx = _mm256_mul_ps(_mm256_add_ps(xmin, xmax), half), ex = _mm256_mul_ps(_mm256_sub_ps(xmax, xmin), half);
+                    __m256 cy = _mm256_mul_ps(_mm256_add_ps(ymin, ymax), half), ey = _mm256_mul_ps(_mm256_sub_ps(ymax, ymin), half);
+                    __m256 cz = _mm256_mul_ps(_mm256_add_ps(zmin, zmax), half), ez = _mm256_mul_ps(_mm256_sub_ps(zmax, zmin), half);
+                    __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+                    for (const vector4f &p : planes) {
+                        __m256 px = _mm256_set1_ps(p.x), py = _mm256_set1_ps(p.y), pz = _mm256_set1_ps(p.z);
+                        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, cx), _mm256_mul_ps(py, cy)), _mm256_mul_ps(pz, cz)), _mm256_set1_ps(p.w));
+                        __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(sign, px), ex), _mm256_mul_ps(_mm256_andnot_ps(sign, py), ey)), _mm256_mul_ps(_mm256_andnot_ps(sign, pz), ez));
+                        inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+                    }
+
+                    for (int mask = _mm256_movemask_ps(inside), lane = 0; lane < 8; lane++) {
+                        if (mask & (1 << lane)) {
+                            visibleIndices[visible++] = std::uint32_t(i + lane);
+                        }
+                    }
+                }
+
+                std::size_t tail = batch::cull(bounds + i, count - i, viewProjection, visibleIndices + visible);
+
+                for (std::size_t k = visible; k < visible + tail; k++) {
+                    visibleIndices[k] += std::uint32_t(i);
+                }
+
+                return visible + tail;
+            }
+
+            MATH_TARGET_AVX2 inline void toRGBA8(const color *source, std::uint32_t *result, std::size_t count) {
+                __m256 k = _mm256_set1_ps(255.0f);
+                __m256i mask = _mm256_set1_epi32(255);
+                __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+                std::size_t i = 0;
+
+                for (; i + 8 <= count; i += 8) {
+                    __m256i c0 = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&source[i + 0].r), k)), mask);
+                    __m256i c1 = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&source[i + 2].r), k)), mask);
+                    __m256i c2 = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&source[i + 4].r), k)), mask);
+                    __m256i c3 = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&source[i + 6].r), k)), mask);
+
+                    // packing works inside 128-bit halves: even colors end up in the low half, odd ones in the high half
+                    __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(c0, c1), _mm256_packs_epi32(c2, c3));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(result + i), _mm256_permutevar8x32_epi32(bytes, order));
+                }
+
+                batch::convert(source + i, result + i, count - i);
+            }
+
+            MATH_TARGET_AVX2 inline void fromRGBA8(const std::uint32_t *source, color *result, std::size_t count) {
+                __m256 k = _mm256_set1_ps(255.0f);
+                std::size_t i = 0;
+
+                for (; i + 8 <= count; i += 8) {
+                    for (std::size_t pair = 0; pair < 8; pair += 2) {
+                        __m256i channels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + i + pair)));
+                        _mm256_storeu_ps(&result[i + pair].r, _mm256_div_ps(_mm256_cvtepi32_ps(channels), k));
+                    }
+                }
+
+                batch::convert(source + i, result + i, count - i);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // AVX-512F: 16 elements per step, the rest goes to the SSE2 kernel
+
+    #if defined(__GNUC__) && !defined(__clang__)
+        // GCC 12 headers leave the pass-through operand of several AVX-512 intrinsics undefined on purpose
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    #endif
+
+        namespace avx512 {
+            MATH_TARGET_AVX512 inline __m512 normalizeFactor(__m512 lengthSq, bool exact) {
+                __m512 one = _mm512_set1_ps(scalar(1.0));
+                __m512 factor;
+                __mmask16 valid;
+
+                if (exact) {
+                    __m512 length = _mm512_sqrt_ps(lengthSq);
+                    valid = _mm512_cmp_ps_mask(length, _mm512_set1_ps(std::numeric_limits<scalar>::epsilon()), _CMP_GT_OQ);
+                    factor = _mm512_div_ps(one, length);
+                }
+                else {
+                    // rsqrt14 and one Newton step
+                    __m512 y = _mm512_rsqrt14_ps(lengthSq);
+                    __m512 halfLengthSq = _mm512_mul_ps(_mm512_set1_ps(scalar(0.5)), lengthSq);
+                    valid = _mm512_cmp_ps_mask(lengthSq, _mm512_set1_ps(std::numeric_limits<scalar>::epsilon() * std::numeric_limits<scalar>::epsilon()), _CMP_GT_OQ);
+                    factor = _mm512_mul_ps(y, _mm512_sub_ps(_mm512_set1_ps(scalar(1.5)), _mm512_mul_ps(halfLengthSq, _mm512_mul_ps(y, y))));
+                }
+
+                return _mm512_mask_blend_ps(valid, one, factor);
+            }
+
+            // 16 x vector3f = 3 registers; each component is gathered by two two-source permutations
+            struct Transposition {
+                __m512i load[3][2];
+                __m512i store[3][2];
+
+                MATH_TARGET_AVX512 Transposition() {
+                    alignas(64) std::int32_t indices[16];
+
+                    for (int k = 0; k < 3; k++) {
+                        // component k of point j is at flat 3j + k: first from registers 0 and 1, then the rest from register 2
+                        for (int j = 0; j < 16; j++) indices[j] = 3 * j + k < 32 ? 3 * j + k : 0;
+                        load[k][0] = _mm512_load_si512(indices);
+                        for (int j = 0; j < 16; j++) indices[j] = 3 * j + k < 32 ? j : 16 + 3 * j + k - 32;
+                        load[k][1] = _mm512_load_si512(indices);
+
+                        // flat n of output register k takes component n % 3 of point n / 3: x and y first, then z
+                        for (int j = 0; j < 16; j++) {
+                            int n = 16 * k + j;
+                            indices[j] = n % 3 == 1 ? 16 + n / 3 : n / 3;
+                        }
+                        store[k][0] = _mm512_load_si512(indices);
+                        for (int j = 0; j < 16; j++) {
+                            int n = 16 * k + j;
+                            indices[j] = n % 3 == 2 ? 16 + n / 3 : j;
+                        }
+                        store[k][1] = _mm512_load_si512(indices);
+                    }
+                }
+            };
+
+            MATH_TARGET_AVX512 inline const Transposition &transposition() {
+                static const Transposition result;
+                return result;
+            }
+
+            MATH_TARGET_AVX512 inline void loadTransposed(const Transposition &t, const vector3f *p, __m512 &x, __m512 &y, __m512 &z) {
+                const scalar *flat = p[0].flat3;
+                __m512 a = _mm512_loadu_ps(flat), b = _mm512_loadu_ps(flat + 16), c = _mm512_loadu_ps(flat + 32);
+                x = _mm512_permutex2var_ps(_mm512_permutex2var_ps(a, t.load[0][0], b), t.load[0][1], c);
+                y = _mm512_permutex2var_ps(_mm512_permutex2var_ps(a, t.load[1][0], b), t.load[1][1], c);
+                z = _mm512_permutex2var_ps(_mm512_permutex2var_ps(a, t.load[2][0], b), t.load[2][1], c);
+            }
+
+            MATH_TARGET_AVX512 inline void storeTransposed(const Transposition &t, vector3f *p, __m512 x, __m512 y, __m512 z) {
+                scalar *flat = p[0].flat3;
+                _mm512_storeu_ps(flat, _mm512_permutex2var_ps(_mm512_permutex2var_ps(x, t.store[0][0], y), t.store[0][1], z));
+                _mm512_storeu_ps(flat + 16, _mm512_permutex2var_ps(_mm512_permutex2var_ps(x, t.store[1][0], y), t.store[1][1], z));
+                _mm512_storeu_ps(flat + 32, _mm512_permutex2var_ps(_mm512_permutex2var_ps(x, t.store[2][0], y), t.store[2][1], z));
+            }
+
+            MATH_TARGET_AVX512 inline void transform(const vector3f *points, vector3f *result, std::size_t count, const transform3f &trfm, bool likePosition) {
+                const Transposition &t = transposition();
+                scalar w = likePosition ? scalar(1.0) : scalar(0.0);
+                __m512 m11 = _mm512_set1_ps(trfm._11), m12 = _mm512_set1_ps(trfm._12), m13 = _mm512_set1_ps(trfm._13);
+                __m512 m21 = _mm512_set1_ps(trfm._21), m22 = _mm512_set1_ps(trfm._22), m23 = _mm512_set1_ps(trfm._23);
+                __m512 m31 = _mm512_set1_ps(trfm._31), m32 = _mm512_set1_ps(trfm._32), m33 = _mm512_set1_ps(trfm._33);
+                __m512 m41 = _mm512_set1_ps(w * trfm._41), m42 = _mm512_set1_ps(w * trfm._42), m43 = _mm512_set1_ps(w * trfm._43);
+                std::size_t i = 0;
+
+                for (; i + 16 <= count; i += 16) {
+                    __m512 x, y, z;
+                    loadTransposed(t, points + i, x, y, z);
+                    __m512 rx = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, m11), _mm512_mul_ps(y, m21)), _mm512_add_ps(_mm512_mul_ps(z, m31), m41));
+                    __m512 ry = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, m12), _mm512_mul_ps(y, m22)), _mm512_add_ps(_mm512_mul_ps(z, m32), m42));
+                    __m512 rz = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, m13), _mm512_mul_ps(y, m23)), _mm512_add_ps(_mm512_mul_ps(z, m33), m43));
+                    storeTransposed(t, result + i, rx, ry, rz);
+                }
+
+                batch::transform(points + i, result + i, count - i, trfm, likePosition);
+            }
+
+            MATH_TARGET_AVX512 inline void normalize2(const vector2f *source, vector2f *result, std::size_t count, bool exact) {
+                std::size_t i = 0;
+
+                for (; i + 8 <= count; i += 8) {
+                    __m512 v = _mm512_loadu_ps(source[i].flat2);
+                    __m512 sq = _mm512_mul_ps(v, v);
+                    __m512 lengthSq = _mm512_add_ps(sq, _mm512_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+                    _mm512_storeu_ps(result[i].flat2, _mm512_mul_ps(v, normalizeFactor(lengthSq, exact)));
+                }
+
+                batch::normalize(source + i, result + i, count - i, exact);
+            }
+
+            MATH_TARGET_AVX512 inline void normalize3(const vector3f *source, vector3f *result, std::size_t count, bool exact) {
+                const Transposition &t = transposition();
+                std::size_t i = 0;
+
+                for (; i + 16 <= count; i += 16) {
+                    __m512 x, y, z;
+                    loadTransposed(t, source + i, x, y, z);
+                    __m512 lengthSq = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)), _mm512_mul_ps(z, z));
+                    __m512 factor = normalizeFactor(lengthSq, exact);
+                    storeTransposed(t, result + i, _mm512_mul_ps(x, factor), _mm512_mul_ps(y, factor), _mm512_mul_ps(z, factor));
+                }
+
+                batch::normalize(source + i, result + i, count - i, exact);
+            }
+
+            // 4x4 transposition inside each 128-bit quarter
+            MATH_TARGET_AVX512 inline void transposeQuarters(__m512 &a, __m512 &b, __m512 &c, __m512 &d) {
+                __m512 t0 = _mm512_unpacklo_ps(a, b), t1 = _mm512_unpacklo_ps(c, d);
+                __m512 t2 = _mm512_unpackhi_ps(a, b), t3 = _mm512_unpackhi_ps(c, d);
+                a = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+                b = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+                c = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+                d = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+            }
+
+            MATH_TARGET_AVX512 inline void normalizeQ(const quaternion *source, quaternion *result, std::size_t count, bool exact) {
+                std::size_t i = 0;
+
+                for (; i + 16 <= count; i += 16) {
+                    __m512 x = _mm512_loadu_ps(&source[i + 0].x);
+                    __m512 y = _mm512_loadu_ps(&source[i + 4].x);
+                    __m512 z = _mm512_loadu_ps(&source[i + 8].x);
+                    __m512 w = _mm512_loadu_ps(&source[i + 12].x);
+                    transposeQuarters(x, y, z, w);
+
+                    __m512 lengthSq = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)), _mm512_mul_ps(z, z)), _mm512_mul_ps(w, w));
+                    __m512 factor = normalizeFactor(lengthSq, exact);
+                    x = _mm512_mul_ps(x, factor);
+                    y = _mm512_mul_ps(y, factor);
+                    z = _mm512_mul_ps(z, factor);
+                    w = _mm512_mul_ps(w, factor);
+
+                    transposeQuarters(x, y, z, w);
+                    _mm512_storeu_ps(&result[i + 0].x, x);
+                    _mm512_storeu_ps(&result[i + 4].x, y);
+                    _mm512_storeu_ps(&result[i + 8].x, z);
+                    _mm512_storeu_ps(&result[i + 12].x, w);
+                }
+
+                batch::normalize(source + i, result + i, count - i, exact);
+            }
+
+            MATH_TARGET_AVX512 inline std::size_t cull(const bound3f *bounds, std::size_t count, const transform3f &viewProjection, std::uint32_t *visibleIndices) {
+                vector4f planes[6];
+                std::size_t visible = 0;
+                std::size_t i = 0;
+
+                frustumPlanes(viewProjection, planes);
+
+                __m512 half = _mm512_set1_ps(scalar(0.5)), zero = _mm512_setzero_ps();
+                __m512i stride = _mm512_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42, 48, 54, 60, 66, 72, 78, 84, 90);
+
+                for (; i + 16 <= count; i += 16) {
+                    const scalar *flat = &bounds[i].xmin;
+                    __m512 xmin = _mm512_i32gather_ps(stride, flat + 0, 4), xmax = _mm512_i32gather_ps(stride, flat + 3, 4);
+                    __m512 ymin = _mm512_i32gather_ps(stride, flat + 1, 4), ymax = _mm512_i32gather_ps(stride, flat + 4, 4);
+                    __m512 zmin = _mm512_i32gather_ps(stride, flat + 2, 4), zmax = _mm512_i32gather_ps(stride, flat + 5, 4);
+                    __m512 cx = _mm512_mul_ps(_mm512_add_ps(xmin, xmax), half), ex = _mm512_mul_ps(_mm512_sub_ps(xmax, xmin), half);
+                    __m512 cy = _mm512_mul_ps(_mm512_add_ps(ymin, ymax), half), ey = _mm512_mul_ps(_mm512_sub_ps(ymax, ymin), half);
+                    __m512 cz = _mm512_mul_ps(_mm512_add_ps(zmin, zmax), half), ez = _mm512_mul_ps(_mm512_sub_ps(zmax, zmin), half);
+                    __mmask16 inside = 0xffff;
+
+                    for (const vector4f &p : planes) {
+                        __m512 px = _mm512_set1_ps(p.x), py = _mm512_set1_ps(p.y), pz = _mm512_set1_ps(p.z);
+                        __m512 ax = _mm512_set1_ps(std::abs(p.x)), ay = _mm512_set1_ps(std::abs(p.y)), az = _mm512_set1_ps(std::abs(p.z));
+                        __m512 distance = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(px, cx), _mm512_mul_ps(py, cy)), _mm512_mul_ps(pz, cz)), _mm512_set1_ps(p.w));
+                        __m512 radius = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ax, ex), _mm512_mul_ps(ay, ey)), _mm512_mul_ps(az, ez));
+                        inside = _mm512_mask_cmp_ps_mask(inside, _mm512_add_ps(distance, radius), zero, _CMP_GE_OQ);
+                    }
+
+                    for (unsigned mask = inside, lane = 0; lane < 16; lane++) {
+                        if (mask & (1u << lane)) {
+                            visibleIndices[visible++] = std::uint32_t(i + lane);
+                        }
+                    }
+                }
+
+                std::size_t tail = batch::cull(bounds + i, count - i, viewProjection, visibleIndices + visible);
+
+                for (std::size_t k = visible; k < visible + tail; k++) {
+                    visibleIndices[k] += std::uint32_t(i);
+                }
+
+                return visible + tail;
+            }
+
+            MATH_TARGET_AVX512 inline void toRGBA8(const color *source, std::uint32_t *result, std::size_t count) {
+                __m512 k = _mm512_set1_ps(255.0f);
+                __m512i mask = _mm512_set1_epi32(255);
+                std::size_t i = 0;
+
+                for (; i + 16 <= count; i += 16) {
+                    for (std::size_t quad = 0; quad < 16; quad += 4) {
+                        __m512i channels = _mm512_and_si512(_mm512_cvttps_epi32(_mm512_mul_ps(_mm512_loadu_ps(&source[i + quad].r), k)), mask);
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(result + i + quad), _mm512_cvtepi32_epi8(channels));
+                    }
+                }
+
+                batch::convert(source + i, result + i, count - i);
+            }
+
+            MATH_TARGET_AVX512 inline void fromRGBA8(const std::uint32_t *source, color *result, std::size_t count) {
+                __m512 k = _mm512_set1_ps(255.0f);
+                std::size_t i = 0;
+
+                for (; i + 16 <= count; i += 16) {
+                    for (std::size_t quad = 0; quad < 16; quad += 4) {
+                        __m512i channels = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i + quad)));
+                        _mm512_storeu_ps(&result[i + quad].r, _mm512_div_ps(_mm512_cvtepi32_ps(channels), k));
+                    }
+                }
+
+                batch::convert(source + i, result + i, count - i);
+            }
+        }
+
+    #if defined(__GNUC__) && !defined(__clang__)
+        #pragma GCC diagnostic pop
+    #endif
+    #endif
+
+        //------------------------------------------------------------------------------------------------------------------------------------------------------
+        // selection
+
+        // Best instruction set supported by both the CPU and the OS (register state saving for AVX / AVX-512)
+        inline BatchIsa detectIsa() {
+        #if defined(MATH_DISPATCH_AVX) && defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+            bool avx2 = false, avx512 = false;
+
+            if (maxLeaf >= 7) {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+                avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+            }
+
+            return avx512 ? BatchIsa::AVX512 : avx2 ? BatchIsa::AVX2 : BatchIsa::SSE2;
+        #elif defined(MATH_DISPATCH_AVX)
+            // libgcc / compiler-rt check the OS support as well
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") ? BatchIsa::AVX512 : __builtin_cpu_supports("avx2") ? BatchIsa::AVX2 : BatchIsa::SSE2;
+        #elif defined(MATH_BATCH_SSE2)
+            return BatchIsa::SSE2;
+        #else
+            return BatchIsa::Generic;
+        #endif
+        }
+
+        inline const BatchKernels &batchKernels(BatchIsa isa) {
+            static const BatchKernels generic = {
+                generic::transform, generic::normalize2, generic::normalize3, generic::normalizeQ, generic::cull, generic::toRGBA8, generic::fromRGBA8,
+            };
+
+        #ifdef MATH_BATCH_SSE2
+            static const BatchKernels sse2 = {
+                [](const vector3f *points, vector3f *result, std::size_t count, const transform3f &trfm, bool likePosition) { batch::transform(points, result, count, trfm, likePosition); },
+                [](const vector2f *source, vector2f *result, std::size_t count, bool exact) { batch::normalize(source, result, count, exact); },
+                [](const vector3f *source, vector3f *result, std::size_t count, bool exact) { batch::normalize(source, result, count, exact); },
+                [](const quaternion *source, quaternion *result, std::size_t count, bool exact) { batch::normalize(source, result, count, exact); },
+                batch::cull,
+                [](const color *source, std::uint32_t *result, std::size_t count) { batch::convert(source, result, count); },
+                [](const std::uint32_t *source, color *result, std::size_t count) { batch::convert(source, result, count); },
+            };
+
+            if (isa == BatchIsa::SSE2) {
+                return sse2;
+            }
+        #endif
+        #ifdef MATH_DISPATCH_AVX
+            static const BatchKernels avx2 = {
+                avx2::transform, avx2::normalize2, avx2::normalize3, avx2::normalizeQ, avx2::cull, avx2::toRGBA8, avx2::fromRGBA8,
+            };
+            static const BatchKernels avx512 = {
+                avx512::transform, avx512::normalize2, avx512::normalize3, avx512::normalizeQ, avx512::cull, avx512::toRGBA8, avx512::fromRGBA8,
+            };
+
+            if (isa == BatchIsa::AVX2) {
+                return avx2;
+            }
+            if (isa == BatchIsa::AVX512) {
+                return avx512;
+            }
+        #endif
+
+            return generic;
+        }
+
+        // Kernels are picked once, on the first call of any dispatch function
+        inline std::atomic<const BatchKernels *> &selectedKernels() {
+            static std::atomic<const BatchKernels *> kernels {&batchKernels(detectIsa())};
+            return kernels;
+        }
+
+        inline std::atomic<BatchIsa> &selectedIsa() {
+            static std::atomic<BatchIsa> isa {detectIsa()};
+            return isa;
+        }
+    }
+
+    namespace dispatch {
+        // best instruction set of this machine
+        inline BatchIsa supportedIsa() {
+            static const BatchIsa isa = imp::detectIsa();
+            return isa;
+        }
+
+        inline BatchIsa selectedIsa() {
+            return imp::selectedIsa().load(std::memory_order_relaxed);
+        }
+
+        // Forces the kernel set, meant for tests and benchmarks. False (and nothing changes) if the machine does not support 'isa'.
+        inline bool select(BatchIsa isa) {
+            if (isa > supportedIsa()) {
+                return false;
+            }
+
+            imp::selectedKernels().store(&imp::batchKernels(isa), std::memory_order_relaxed);
+            imp::selectedIsa().store(isa, std::memory_order_relaxed);
+            return true;
+        }
+
+        // same as the batch:: functions with these names
+
+        inline void transform(const vector3f *points, vector3f *result, std::size_t count, const transform3f &trfm, bool likePosition = false) {
+            imp::selectedKernels().load(std::memory_order_relaxed)->transform(points, result, count, trfm, likePosition);
+        }
+
+        inline void normalize(const vector2f *source, vector2f *result, std::size_t count, bool exact = false) {
+            imp::selectedKernels().load(std::memory_order_relaxed)->normalize2(source, result, count, exact);
+        }
+
+        inline void normalize(const vector3f *source, vector3f *result, std::size_t count, bool exact = false) {
+            imp::selectedKernels().load(std::memory_order_relaxed)->normalize3(source, result, count, exact);
+        }
+
+        inline void normalize(const quaternion *source, quaternion *result, std::size_t count, bool exact = false) {
+            imp::selectedKernels().load(std::memory_order_relaxed)->normalizeQ(source, result, count, exact);
+        }
+
+        inline std::size_t cull(const bound3f *bounds, std::size_t count, const transform3f &viewProjection, std::uint32_t *visibleIndices) {
+            return imp::selectedKernels().load(std::memory_order_relaxed)->cull(bounds, count, viewProjection, visibleIndices);
+        }
+
+        inline void convert(const color *source, std::uint32_t *result, std::size_t count) {
+            imp::selectedKernels().load(std::memory_order_relaxed)->toRGBA8(source, result, count);
+        }
+
+        inline void convert(const std::uint32_t *source, color *result, std::size_t count) {
+            imp::selectedKernels().load(std::memory_order_relaxed)->fromRGBA8(source, result, count);
+        }
+    }
+}
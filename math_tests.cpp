@@ -1,10 +1,25 @@
 
 #include <cassert>
 #include <limits>
+#include <chrono>
+#include <cstdio>
 
 #include "math.h"
+#include "math_batch.h"
+#include "math_text.h"
+#include "math_archive.h"
+#include "pointcloud.h"
+#include "collision2d.h"
+#include "broadphase.h"
+#include "noise.h"
+#include "occlusion.h"
+#include "particles.h"
+#include "ik.h"
+#include "intersection2d.h"
+#include "math_dispatch.h"
 #include "math_tests.h"
 
+// REQUIRE is assert, so it is compiled out with NDEBUG: calls with side effects go outside of it, checks of their results inside
 #define REQUIRE(x) assert(x)
 
 namespace math {
@@ -39,6 +54,22 @@ namespace math {
                 std::abs(a.z - b.z) <= eps &&
                 std::abs(a.w - b.w) <= eps;
         }
+        bool equal(const math::matrix3f &a, const math::matrix3f &b) {
+            for (int i = 0; i < 9; i++) {
+                if (std::abs(a.flat9[i] - b.flat9[i]) > eps) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        bool equal(const math::transform3f &a, const math::transform3f &b) {
+            for (int i = 0; i < 16; i++) {
+                if (std::abs(a.flat16[i] - b.flat16[i]) > eps) {
+                    return false;
+                }
+            }
+            return true;
+        }
         bool equal(const math::transform2f &a, const math::transform2f &b) {
             return
                 std::abs(a._11 - b._11) <= eps &&
@@ -402,6 +433,1056 @@ namespace math {
             REQUIRE(equal(v1.transformed(t1).xz.angleTo(v1.xz), math::PI_6));
             REQUIRE(equal(v1.transformed(t6), {1, 3, -7}));
         }
+
+        void matrix3Operating() {
+            math::quaternion q ({1, 2, 3}, math::PI_6);
+            q = q.normalized();
+            math::matrix3f m (q);
+            math::transform3f t (q);
+            math::vector3f v {1, 7, 3};
+
+            REQUIRE(equal(m.rows[0], t.rows[0].xyz));
+            REQUIRE(equal(m.rows[2], t.rows[2].xyz));
+            REQUIRE(equal(v.transformed(m), v.transformed(q)));
+            REQUIRE(equal(math::quaternion(m), q));
+            REQUIRE(equal(math::quaternion(math::matrix3f(math::quaternion({0, 1, 0}, math::PI))), math::quaternion(math::transform3f(math::quaternion({0, 1, 0}, math::PI)))));
+            REQUIRE(equal(m * m.transposed(), math::matrix3f::identity()));
+            REQUIRE(equal(m.inverted(), m.transposed()));
+            REQUIRE(equal(m.determinant(), 1));
+            REQUIRE(equal(math::transform3f(m), t));
+
+            math::vector3f translation, scale;
+            math::matrix3f rotation;
+            math::quaternion rotationq;
+            math::transform3f trs = math::transform3f::identity().scaled({2, 3, 4}) * math::transform3f({5, 6, 7}, q);
+
+            trs.decompose(translation, rotation, scale);
+            REQUIRE(equal(translation, {5, 6, 7}));
+            REQUIRE(std::abs(scale.x - 2) < 0.00001f && std::abs(scale.y - 3) < 0.00001f && std::abs(scale.z - 4) < 0.00001f);
+            REQUIRE(equal(rotation, m));
+
+            trs.decompose(translation, rotationq, scale);
+            REQUIRE(equal(rotationq, q));
+
+            math::transform3f mirrored = math::transform3f::identity().scaled({-1, 1, 1}) * t;
+            mirrored.decompose(translation, rotation, scale);
+            REQUIRE(equal(scale, {-1, 1, 1}));
+            REQUIRE(equal(rotation, m));
+        }
+
+        void trsOperating() {
+            math::trs3f a ({1, 2, 3}, math::quaternion({0, 1, 0}, math::PI_6), math::vector3f(2));
+            math::trs3f b ({-4, 0, 5}, math::quaternion({1, 0, 0}, math::PI_2), math::vector3f(math::scalar(0.5)));
+            math::trs3f c ({0, 1, 0}, math::quaternion({0, 0, 1}, math::PI_4), {1, 2, 3});
+            math::transform3f ta = a;
+            math::transform3f tb = b;
+            math::vector3f v {1, 7, 3};
+
+            REQUIRE(equal(v.transformed(a, true), v.transformed(ta, true)));
+            REQUIRE(equal(v.transformed(a), v.transformed(ta)));
+            REQUIRE(equal(math::transform3f(a * b), ta * tb));
+            REQUIRE(equal(v.transformed(a * b, true), v.transformed(ta * tb, true)));
+            REQUIRE(equal(math::transform3f(a.inverted()), ta.inverted()));
+            REQUIRE(equal(v.transformed(a, true).transformed(a.inverted(), true), v));
+            REQUIRE(equal(math::transform3f(c * math::trs3f::identity()), math::transform3f(c)));
+            REQUIRE(equal(math::transform3f(math::trs3f(math::transform3f(c))), math::transform3f(c)));
+
+            math::trs3f sources[3] = {a, b, c};
+            math::transform3f targets[3];
+            math::batch::convert(sources, targets, 3);
+            REQUIRE(equal(targets[1], tb));
+        }
+
+        void boundOperating() {
+            math::bound3f b {-1, -2, -3, 1, 2, 3};
+            math::transform3f trfm = math::transform3f({5, 6, 7}, math::quaternion(math::vector3f(1, 1, 0).normalized(), math::PI_6)).scaled({1, 2, 1});
+            math::bound3f corners = math::bound3f::empty();
+
+            for (int i = 0; i < 8; i++) {
+                math::vector3f corner {i & 1 ? b.xmax : b.xmin, i & 2 ? b.ymax : b.ymin, i & 4 ? b.zmax : b.zmin};
+                corners = corners.merged(corner.transformed(trfm, true));
+            }
+
+            math::bound3f arvo = b.transformed(trfm);
+            REQUIRE(std::abs(arvo.xmin - corners.xmin) < 0.00001f && std::abs(arvo.zmax - corners.zmax) < 0.00001f);
+            REQUIRE(std::abs(arvo.ymax - corners.ymax) < 0.00001f && std::abs(arvo.ymin - corners.ymin) < 0.00001f);
+            REQUIRE(math::bound3f::empty().isEmpty());
+            REQUIRE(math::bound3f::empty().transformed(trfm).isEmpty());
+            REQUIRE(equal(b.center(), {0, 0, 0}));
+            REQUIRE(equal(b.extent(), {1, 2, 3}));
+            REQUIRE(b.intersects({0, 0, 0, 5, 5, 5}) && !b.intersects({2, 0, 0, 5, 5, 5}));
+
+            math::bound2f b2 {0, 0, 2, 1};
+            math::bound2f b2t = b2.transformed(math::transform2f({1, 1}, math::PI_2));
+            REQUIRE(equal(b2t.xmin, 0) && equal(b2t.xmax, 1) && equal(b2t.ymin, 1) && equal(b2t.ymax, 3));
+            REQUIRE(b2.merged(math::vector2f{-1, 5}).contains({-1, 5}));
+
+            math::bound3f bounds[5] = {b, {0, 0, 0, 9, 1, 1}, math::bound3f::empty(), {-4, 0, 0, 0, 0, 8}, b};
+            math::transform3f trfms[5] = {trfm, math::transform3f::identity(), trfm, math::transform3f({1, 2, 3}), trfm.inverted()};
+            math::bound3f transformed[5];
+            math::bound3f all = math::batch::merged(bounds, 5);
+
+            REQUIRE(equal(all.xmin, -4) && equal(all.xmax, 9) && equal(all.ymin, -2) && equal(all.zmax, 8));
+            REQUIRE(math::batch::merged(bounds, 0).isEmpty());
+
+            math::batch::transform(bounds, trfms, transformed, 5);
+
+            for (int i = 0; i < 5; i++) {
+                math::bound3f expected = bounds[i].transformed(trfms[i]);
+                REQUIRE(std::abs(expected.xmin - transformed[i].xmin) < 0.00001f && std::abs(expected.zmax - transformed[i].zmax) < 0.00001f);
+            }
+
+            math::batch::transform(bounds, transformed, 5, trfm);
+
+            for (int i = 0; i < 5; i++) {
+                math::bound3f expected = bounds[i].transformed(trfm);
+                REQUIRE(std::abs(expected.xmin - transformed[i].xmin) < 0.00001f && std::abs(expected.ymin - transformed[i].ymin) < 0.00001f && std::abs(expected.zmax - transformed[i].zmax) < 0.00001f);
+            }
+
+            math::bound2f bounds2[3] = {b2, math::bound2f::empty(), {-3, 1, -1, 4}};
+            math::transform2f trfms2[3] = {math::transform2f({1, 1}, math::PI_2), math::transform2f::identity(), math::transform2f({2, -1}, math::PI_6)};
+            math::bound2f transformed2[3];
+
+            math::batch::transform(bounds2, trfms2, transformed2, 3);
+
+            for (int i = 0; i < 3; i++) {
+                math::bound2f expected = bounds2[i].transformed(trfms2[i]);
+                REQUIRE(std::abs(expected.xmin - transformed2[i].xmin) < 0.00001f && std::abs(expected.ymin - transformed2[i].ymin) < 0.00001f && std::abs(expected.xmax - transformed2[i].xmax) < 0.00001f && std::abs(expected.ymax - transformed2[i].ymax) < 0.00001f);
+            }
+
+            math::batch::transform(bounds2, transformed2, 3, trfms2[2]);
+
+            for (int i = 0; i < 3; i++) {
+                math::bound2f expected = bounds2[i].transformed(trfms2[2]);
+                REQUIRE(std::abs(expected.xmin - transformed2[i].xmin) < 0.00001f && std::abs(expected.ymin - transformed2[i].ymin) < 0.00001f && std::abs(expected.xmax - transformed2[i].xmax) < 0.00001f && std::abs(expected.ymax - transformed2[i].ymax) < 0.00001f);
+            }
+        }
+
+        void collision2Operating() {
+            math::box2f a ({1, 1}, math::transform2f::identity());
+            math::box2f b ({1, 1}, math::transform2f({math::scalar(1.5), 0}));
+            math::box2f c ({1, 1}, math::transform2f({3, 3}, math::PI_4));
+            math::box2f d ({1, 1}, math::transform2f({0, math::scalar(2.2)}, math::PI_4));
+            math::contact2f contact;
+
+            REQUIRE(math::overlaps(a, b));
+            REQUIRE(!math::overlaps(a, c));
+            REQUIRE(math::overlaps(a, d));
+            REQUIRE(equal(math::vector2f{3, 4}.projectedTo({1, 0}), {3, 0}));
+            REQUIRE(equal(math::vector2f{1, -1}.reflectedBy({0, 1}), {1, 1}));
+
+            bool collided = math::collide(math::convex2f(a), math::convex2f(b), contact);
+            REQUIRE(collided);
+            REQUIRE(equal(contact.normal, {1, 0}));
+            REQUIRE(equal(contact.depth, math::scalar(0.5)));
+            REQUIRE(contact.pointCount == 2);
+            REQUIRE(equal(contact.points[0].x, math::scalar(0.5)) && equal(contact.points[1].x, math::scalar(0.5)));
+
+            collided = math::collide(math::convex2f(b), math::convex2f(a), contact);
+            REQUIRE(collided);
+            REQUIRE(equal(contact.normal, {-1, 0}));
+
+            collided = math::collide(math::convex2f(a), math::convex2f(d), contact);
+            REQUIRE(collided);
+            REQUIRE(equal(contact.normal, {0, 1}));
+            REQUIRE(contact.pointCount == 1);
+            REQUIRE(std::abs(contact.depth - (math::scalar(1.0) - (math::scalar(2.2) - std::sqrt(math::scalar(2.0))))) < 0.0001f);
+            collided = math::collide(math::convex2f(a), math::convex2f(c), contact);
+            REQUIRE(!collided);
+
+            math::vector2f triangle[3] = {{0, 0}, {0, 2}, {2, 0}};
+            math::convex2f t (triangle, 3, math::transform2f({-2, 0}));
+            math::convex2f candidates[4] = {math::convex2f(a), math::convex2f(b), math::convex2f(c), t};
+            math::contact2f contacts[4];
+            std::size_t indices[4];
+
+            REQUIRE(math::overlaps(t, math::convex2f(a)));
+            std::size_t collidedCount = math::collide(math::convex2f(b), candidates, 4, contacts, indices);
+            REQUIRE(collidedCount == 2);
+            REQUIRE(indices[0] == 0 && indices[1] == 1);
+
+            math::box2f boxes[3] = {b, c, d};
+            std::size_t overlapCount = math::overlaps(a, boxes, 3, indices);
+            REQUIRE(overlapCount == 2);
+            REQUIRE(indices[0] == 0 && indices[1] == 2);
+        }
+
+        void predicatesExactness() {
+            REQUIRE(math::orient2d({0, 0}, {1, 0}, {0, 1}) == 1);
+            REQUIRE(math::orient2d({0, 0}, {0, 1}, {1, 0}) == -1);
+            REQUIRE(math::orient2d({0, 0}, {1, 1}, {3, 3}) == 0);
+
+            // points on the line y = x near 0.5 with one ulp offsets, naive float cross product gets these wrong
+            math::scalar u = std::nextafter(math::scalar(0.5), math::scalar(1.0));
+            math::vector2f p0 = {12, 12}, p1 = {24, 24};
+            REQUIRE(math::orient2d(p0, p1, {math::scalar(0.5), math::scalar(0.5)}) == 0);
+            REQUIRE(math::orient2d(p0, p1, {math::scalar(0.5), u}) == 1);
+            REQUIRE(math::orient2d(p0, p1, {u, math::scalar(0.5)}) == -1);
+
+            for (int i = 0; i < 64; i++) {
+                math::vector2f p = {math::scalar(0.5) + math::scalar(i) * std::numeric_limits<math::scalar>::epsilon(), math::scalar(0.5)};
+                int expected = i == 0 ? 0 : -1;
+                REQUIRE(math::orient2d(p0, p1, p) == expected);
+                REQUIRE(math::orient2d(p1, p0, p) == -expected);
+                REQUIRE(math::orient2d(p, p0, p1) == expected);
+            }
+
+            REQUIRE(math::orient3d({0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, -1}) == 1);
+            REQUIRE(math::orient3d({0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}) == -1);
+            REQUIRE(math::orient3d({0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {7, 3, 0}) == 0);
+            REQUIRE(math::orient3d({1, 1, 1}, {2, 2, 2}, {4, 0, 4}, {u, u, u}) == 0);
+            REQUIRE(math::orient3d({1, 1, 1}, {2, 2, 2}, {4, 0, 4}, {math::scalar(0.5), math::scalar(0.5), u}) != 0);
+
+            REQUIRE(math::incircle({0, 0}, {1, 0}, {0, 1}, {math::scalar(0.5), math::scalar(0.5)}) == 1);
+            REQUIRE(math::incircle({0, 0}, {1, 0}, {0, 1}, {1, 1}) == 0);
+            REQUIRE(math::incircle({0, 0}, {1, 0}, {0, 1}, {1, std::nextafter(math::scalar(1.0), math::scalar(2.0))}) == -1);
+            REQUIRE(math::incircle({0, 0}, {0, 1}, {1, 0}, {math::scalar(0.5), math::scalar(0.5)}) == -1);
+
+            REQUIRE(equal(math::vector2f{1, -1}.boundedToLeft({0, 0}, {2, 0}), {1, 0}));
+            REQUIRE(equal(math::vector2f{1, 1}.boundedToLeft({0, 0}, {2, 0}), {1, 1}));
+            REQUIRE(equal(math::vector2f{1, 1}.boundedToRight({0, 0}, {2, 0}), {1, 0}));
+        }
+
+        void noiseEvaluation() {
+            const std::size_t count = 43;
+            math::vector2f p2[count];
+            math::vector3f p3[count];
+            math::scalar x[count], y[count], z[count], w[count], r[count], q[count];
+
+            for (std::size_t i = 0; i < count; i++) {
+                x[i] = math::scalar(i) * math::scalar(0.37) - 5;
+                y[i] = math::scalar(i) * math::scalar(-0.71) + 3;
+                z[i] = math::scalar(i % 7) * math::scalar(1.13);
+                w[i] = math::scalar(i % 5) * math::scalar(-0.29);
+                p2[i] = {x[i], y[i]};
+                p3[i] = {x[i], y[i], z[i]};
+            }
+
+            // lattice points of gradient noise are zero, simplex noise is continuous and seeded
+            REQUIRE(math::gradientNoise(math::vector2f{3, -2}) == 0);
+            REQUIRE(math::gradientNoise(math::vector3f{3, -2, 7}, 5) == 0);
+            REQUIRE(math::simplexNoise(math::vector2f{0.3f, 0.4f}, 1) != math::simplexNoise(math::vector2f{0.3f, 0.4f}, 2));
+            REQUIRE(std::abs(math::simplexNoise(math::vector3f{0.3f, 0.4f, 0.5f}) - math::simplexNoise(math::vector3f{0.3001f, 0.4f, 0.5f})) < 0.01f);
+            REQUIRE(std::abs(math::simplexNoise(math::vector4f{0.3f, 0.4f, 0.5f, 0.6f}) - math::simplexNoise(math::vector4f{0.3f, 0.4f, 0.5f, 0.6001f})) < 0.01f);
+            REQUIRE(std::abs(math::gradientNoise(math::vector4f{0.3f, 0.4f, 0.5f, 0.6f}) - math::gradientNoise(math::vector4f{0.3f, 0.4f, 0.5001f, 0.6f})) < 0.01f);
+
+            math::batch::noise(x, y, r, count, 9);
+            math::batch::fractal(p2, q, count, {1, 2, 0.5f, 9});
+
+            for (std::size_t i = 0; i < count; i++) {
+                REQUIRE(std::abs(r[i] - math::simplexNoise(p2[i], 9)) < 0.00001f && q[i] == r[i]);
+                REQUIRE(std::abs(r[i]) <= 1);
+            }
+
+            math::batch::noise<math::GradientNoise>(x, y, z, w, r, count);
+
+            for (std::size_t i = 0; i < count; i++) {
+                REQUIRE(equal(r[i], math::gradientNoise(math::vector4f{x[i], y[i], z[i], w[i]})));
+            }
+
+            math::FractalOptions options;
+            options.octaves = 5;
+            math::batch::fractal<math::GradientNoise>(p3, r, count, options);
+            math::batch::fractal<math::GradientNoise>(x, y, z, q, count, options);
+
+            for (std::size_t i = 0; i < count; i++) {
+                REQUIRE(equal(r[i], math::fbm<math::GradientNoise>(p3[i], options)) && r[i] == q[i]);
+            }
+
+
+        #ifdef MATH_BATCH_SSE2
+            // lattice cells of coordinates beyond the int32 range are clamped the same way by lanes and scalars
+            math::scalar edges[8] = {3.5f, -3.5f, 1e10f, -1e10f, std::numeric_limits<math::scalar>::quiet_NaN(), 2147483648.0f, -0.5f, 0};
+            math::imp::uintx8 cells = math::imp::laneFloor(math::imp::floatx8{_mm_loadu_ps(edges), _mm_loadu_ps(edges + 4)});
+            std::uint32_t lanes[8];
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), cells.lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes + 4), cells.hi);
+
+            for (std::size_t i = 0; i < 8; i++) {
+                REQUIRE(lanes[i] == math::imp::laneFloor(edges[i]));
+            }
+
+            REQUIRE(lanes[0] == 3 && lanes[1] == std::uint32_t(-4) && lanes[2] == 1u << 30 && lanes[3] == std::uint32_t(-(1 << 30)) && lanes[6] == std::uint32_t(-1));
+        #endif
+        }
+
+        void broadphaseTracking() {
+            math::SweepAndPrune<math::bound2f> sap;
+            std::uint32_t a = sap.add({0, 0, 1, 1});
+            std::uint32_t b = sap.add({2, 0, 3, 1});
+            std::uint32_t c = sap.add({1, 1, 2, 2});
+
+            sap.update();
+            REQUIRE(sap.added().size() == 2 && sap.removed().empty());
+            REQUIRE(sap.overlapping(a, c) && sap.overlapping(b, c) && !sap.overlapping(a, b));
+
+            sap.move(b, {4, 0, 5, 1});
+            sap.update();
+            REQUIRE(sap.added().empty() && sap.removed().size() == 1);
+            REQUIRE(sap.removed()[0].a == b && sap.removed()[0].b == c);
+
+            sap.update();
+            REQUIRE(sap.added().empty() && sap.removed().empty());
+
+            sap.remove(a);
+            sap.update();
+            REQUIRE(sap.removed().size() == 1 && sap.pairCount() == 0);
+
+            std::uint32_t reused = sap.add({1, 1, 4, 1});
+            REQUIRE(reused == a);
+
+            // random walk against brute force
+            math::SweepAndPrune<math::bound3f> sap3;
+            std::vector<math::bound3f> bounds;
+            std::unordered_set<std::uint64_t> pairs;
+            std::uint32_t seed = 7;
+
+            auto random = [&seed]() {
+                seed = seed * 1664525u + 1013904223u;
+                return math::scalar(seed >> 8) / math::scalar(1 << 24);
+            };
+
+            for (std::uint32_t i = 0; i < 64; i++) {
+                math::vector3f p = {random() * 10, random() * 10, random() * 10};
+                bounds.push_back({p, p + 1});
+                std::uint32_t id = sap3.add(bounds.back());
+                REQUIRE(id == i);
+            }
+            for (int tick = 0; tick < 20; tick++) {
+                for (std::uint32_t i = 0; i < bounds.size(); i++) {
+                    math::vector3f d = {random() - math::scalar(0.5), random() - math::scalar(0.5), random() - math::scalar(0.5)};
+                    bounds[i] = {bounds[i].xmin + d.x, bounds[i].ymin + d.y, bounds[i].zmin + d.z, bounds[i].xmax + d.x, bounds[i].ymax + d.y, bounds[i].zmax + d.z};
+                    sap3.move(i, bounds[i]);
+                }
+
+                sap3.update();
+
+                for (const math::BroadphasePair &p : sap3.removed()) {
+                    std::size_t erased = pairs.erase(std::uint64_t(p.a) << 32 | p.b);
+                    REQUIRE(erased == 1);
+                }
+                for (const math::BroadphasePair &p : sap3.added()) {
+                    bool inserted = pairs.insert(std::uint64_t(p.a) << 32 | p.b).second;
+                    REQUIRE(p.a < p.b && inserted);
+                }
+
+                std::size_t expected = 0;
+
+                for (std::uint32_t i = 0; i < bounds.size(); i++) {
+                    for (std::uint32_t k = i + 1; k < bounds.size(); k++) {
+                        bool overlap = bounds[i].intersects(bounds[k]);
+                        expected += overlap ? 1 : 0;
+                        REQUIRE(overlap == (pairs.count(std::uint64_t(i) << 32 | k) != 0));
+                    }
+                }
+
+                REQUIRE(expected == sap3.pairCount());
+            }
+        }
+
+        void batchReductions() {
+            math::vector2f points2[37];
+            math::vector3f points3[37];
+
+            for (int i = 0; i < 37; i++) {
+                math::scalar s = math::scalar(i);
+                points2[i] = {std::sin(s) * s, std::cos(s * math::scalar(1.3)) * s};
+                points3[i] = {std::sin(s) * s, std::cos(s * math::scalar(1.3)) * s, std::sin(s * math::scalar(0.7)) * s};
+            }
+
+            math::bound2f b2 = math::batch::boundOf(points2, 37);
+            math::bound3f b3 = math::batch::boundOf(points3, 37);
+            std::size_t nearest2 = 0, nearest3 = 0, support2 = 0, support3 = 0;
+            math::vector2f q2 {3, -5};
+            math::vector3f q3 {3, -5, 2};
+
+            for (int i = 0; i < 37; i++) {
+                REQUIRE(points2[i].x >= b2.xmin && points2[i].x <= b2.xmax && points2[i].y >= b2.ymin && points2[i].y <= b2.ymax);
+                REQUIRE(points3[i].x >= b3.xmin && points3[i].x <= b3.xmax && points3[i].z >= b3.zmin && points3[i].z <= b3.zmax);
+                nearest2 = points2[i].distanceSqTo(q2) < points2[nearest2].distanceSqTo(q2) ? i : nearest2;
+                nearest3 = points3[i].distanceSqTo(q3) < points3[nearest3].distanceSqTo(q3) ? i : nearest3;
+                support2 = points2[i].dot(q2) > points2[support2].dot(q2) ? i : support2;
+                support3 = points3[i].dot(q3) > points3[support3].dot(q3) ? i : support3;
+            }
+
+            REQUIRE(math::batch::nearestIndex(points2, 37, q2) == nearest2);
+            REQUIRE(math::batch::nearestIndex(points3, 37, q3) == nearest3);
+            REQUIRE(math::batch::supportIndex(points2, 37, q2) == support2);
+            REQUIRE(math::batch::supportIndex(points3, 37, q3) == support3);
+            REQUIRE(math::batch::nearestIndex(points3, 0, q3) == 0);
+            REQUIRE(equal(math::batch::boundOf(points3, 1).xmax, points3[0].x));
+        }
+
+        void batchNormalization() {
+            math::vector2f v2[11], r2[11];
+            math::vector3f v3[11], r3[11];
+            math::quaternion q[11], rq[11];
+
+            for (int i = 0; i < 11; i++) {
+                math::scalar s = math::scalar(i);
+                v2[i] = {s - 4, s * s - 20};
+                v3[i] = {s - 4, s * s - 20, math::scalar(1.0) / (s + 1)};
+                q[i] = {s - 4, s * s - 20, math::scalar(1.0) / (s + 1), s};
+            }
+
+            v2[3] = {0, 0};
+            v3[5] = {0, 0, 0};
+            v3[6] = {1e-8f, 0, 0};
+            q[2] = {0, 0, 0, 0};
+
+            math::batch::normalize(v2, r2, 11, true);
+            math::batch::normalize(v3, r3, 11, true);
+            math::batch::normalize(q, rq, 11, true);
+
+            for (int i = 0; i < 11; i++) {
+                REQUIRE(r2[i].x == v2[i].normalized().x && r2[i].y == v2[i].normalized().y);
+                REQUIRE(r3[i].x == v3[i].normalized().x && r3[i].y == v3[i].normalized().y && r3[i].z == v3[i].normalized().z);
+                REQUIRE(i == 2 || (rq[i].x == q[i].normalized().x && rq[i].w == q[i].normalized().w));
+            }
+
+            REQUIRE(equal(r2[3], {0, 0}) && equal(r3[5], {0, 0, 0}) && equal(r3[6], v3[6]));
+            REQUIRE(rq[2].x == 0 && rq[2].w == 0);
+
+            math::batch::normalize(v2, v2, 11);
+            math::batch::normalize(v3, v3, 11);
+            math::batch::normalize(q, q, 11);
+
+            for (int i = 0; i < 11; i++) {
+                REQUIRE(i == 3 || std::abs(v2[i].length() - 1) < 0.000002f);
+                REQUIRE(i == 5 || i == 6 || std::abs(v3[i].length() - 1) < 0.000002f);
+                REQUIRE(i == 2 || std::abs(q[i].x * q[i].x + q[i].y * q[i].y + q[i].z * q[i].z + q[i].w * q[i].w - 1) < 0.000004f);
+                REQUIRE(equal(v2[i], r2[i]) && equal(v3[i], r3[i]));
+            }
+        }
+
+        void batchProjection() {
+            math::transform3f view = math::transform3f::lookAtRH({0, 0, 5}, {0, 0, 0}, {0, 1, 0});
+            math::transform3f proj = math::transform3f::perspectiveFovRH(math::PI_2, math::scalar(800.0 / 600.0), 1, 100);
+            math::transform3f vp = view * proj;
+            math::bound2f viewport = {0, 0, 800, 600};
+            math::vector3f points[23];
+            math::vector2f screen[23];
+            math::scalar depth[23];
+            std::uint32_t indices[23];
+
+            for (int i = 0; i < 23; i++) {
+                math::scalar s = math::scalar(i);
+                points[i] = {s * 0.5f - 5, std::sin(s) * 3, -s * 4};
+            }
+
+            points[0] = {0, 0, 0};
+            points[1] = {0, 0, 6};      // behind the eye
+            points[2] = {0, 0, -200};   // beyond far
+            points[3] = {1000, 0, 0};   // outside on the right
+            points[4] = {0, 2, 0};      // up, on screen
+
+            std::size_t count = math::batch::project(points, 23, vp, viewport, screen, depth, indices);
+            std::size_t expected = 0;
+
+            REQUIRE(count >= 2 && indices[0] == 0 && indices[1] == 4);
+            REQUIRE(std::abs(screen[0].x - 400) < 0.001f && std::abs(screen[0].y - 300) < 0.001f);
+            REQUIRE(screen[1].y < 300 && std::abs(screen[1].x - 400) < 0.001f);
+            REQUIRE(depth[0] > 0 && depth[0] < 1);
+
+            for (std::uint32_t i = 0; i < 23; i++) {
+                math::vector4f c = math::vector4f(points[i], 1).transformed(vp);
+                bool visible = c.w > 0 && std::abs(c.x) <= c.w && std::abs(c.y) <= c.w && c.z >= 0 && c.z <= c.w;
+
+                if (visible) {
+                    REQUIRE(indices[expected] == i);
+                    REQUIRE(std::abs(screen[expected].x - (c.x / c.w + 1) * 400) < 0.01f);
+                    REQUIRE(std::abs(screen[expected].y - (1 - c.y / c.w) * 300) < 0.01f);
+                    REQUIRE(std::abs(depth[expected] - c.z / c.w) < 0.000001f);
+                    expected++;
+                }
+            }
+
+            REQUIRE(count == expected && count == 20);
+        }
+
+        void occlusionCulling() {
+            math::OcclusionOptions options;
+            options.threadCount = 3;
+
+            math::OcclusionBuffer occlusion (100, 70, options);
+            math::transform3f view = math::transform3f::lookAtRH({0, 0, 5}, {0, 0, 0}, {0, 1, 0});
+            math::vector3f quad[4] = {{-2, -2, 0}, {2, -2, 0}, {2, 2, 0}, {-2, 2, 0}};
+            std::uint32_t indices[6] = {0, 1, 2, 0, 3, 2};
+
+            occlusion.begin(view * math::transform3f::perspectiveFovRH(math::PI_2, math::scalar(100.0 / 70.0), 1, 100));
+            occlusion.rasterize(quad, indices, 2, math::transform3f(math::vector3f(0.5f, 0, 0)));
+
+            REQUIRE(occlusion.depth(57, 35) > 0.1f && occlusion.depth(0, 0) == 0);
+
+            math::bound3f bounds[6] = {
+                {0.3f, -0.2f, -3.2f, 0.7f, 0.2f, -2.8f},       // behind the quad
+                {0.3f, -0.2f, 0.8f, 0.7f, 0.2f, 1.2f},         // in front of it
+                {4.5f, -0.2f, -3.2f, 4.9f, 0.2f, -2.8f},       // behind, but sticks out of the quad shadow
+                {100.0f, -0.2f, -3.2f, 100.4f, 0.2f, -2.8f},   // outside the frustum
+                {-1.0f, -1.0f, 4.0f, 1.0f, 1.0f, 6.0f},        // contains the eye
+                {0.3f, -0.2f, -200.0f, 0.7f, 0.2f, -199.0f},   // beyond far plane
+            };
+            std::uint32_t visible[6];
+
+            std::size_t visibleCount = occlusion.cull(bounds, 6, visible);
+            REQUIRE(visibleCount == 3 && visible[0] == 1 && visible[1] == 2 && visible[2] == 4);
+            REQUIRE(!occlusion.visible(bounds[0]) && occlusion.visible(bounds[2]));
+
+            // screen rectangles far beyond the int range are clamped: wide bound is visible in an empty buffer, wide occluder hides
+            math::OcclusionBuffer wide (100, 70, {1});
+            math::vector3f wideQuad[4] = {{-1e9f, -1e9f, 0}, {1e9f, -1e9f, 0}, {1e9f, 1e9f, 0}, {-1e9f, 1e9f, 0}};
+
+            wide.begin(view * math::transform3f::perspectiveFovRH(math::PI_2, math::scalar(100.0 / 70.0), 1, 100));
+            REQUIRE(wide.visible({-0.5f, -0.5f, -1.0f, 1e9f, 0.5f, 0.0f}));
+
+            wide.rasterize(wideQuad, indices, 2, math::transform3f::identity());
+            REQUIRE(!wide.visible(bounds[0]) && !wide.visible(bounds[2]) && wide.visible(bounds[1]));
+
+            // single-threaded rasterization and the LH convention give the same answers
+            math::OcclusionBuffer single (100, 70, {1});
+            math::transform3f flip = math::transform3f::identity().scaled({1, 1, -1});
+
+            single.begin(math::transform3f::lookAtLH({0, 0, -5}, {0, 0, 0}, {0, 1, 0}) * math::transform3f::perspectiveFovLH(math::PI_2, math::scalar(100.0 / 70.0), 1, 100));
+            single.rasterize(quad, indices, 2, math::transform3f(math::vector3f(0.5f, 0, 0)) * flip);
+
+            for (std::size_t i = 0; i < 6; i++) {
+                std::swap(bounds[i].zmin, bounds[i].zmax);
+                bounds[i].zmin = -bounds[i].zmin;
+                bounds[i].zmax = -bounds[i].zmax;
+            }
+
+            visibleCount = single.cull(bounds, 6, visible);
+            REQUIRE(visibleCount == 3 && visible[0] == 1 && visible[1] == 2 && visible[2] == 4);
+        }
+
+        void particleIntegration() {
+            const std::size_t count = 37;
+            math::vector3f positions[count], velocities[count];
+            math::vector3f gravity = {0, -9.8f, 0};
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::scalar s = math::scalar(i);
+                positions[i] = {s, s * 0.5f - 3, -s};
+                velocities[i] = {std::sin(s), 2, std::cos(s)};
+            }
+
+            math::ParticleBuffer euler ({1, 4});
+            math::ParticleBuffer verlet ({3, 4});
+            math::ParticleBuffer threaded ({3, 4});
+
+            euler.emit(positions, velocities, count, 1);
+            threaded.emit(positions, velocities, count, 1);
+            verlet.emit(positions, velocities, 20, 1);
+            verlet.emit(positions + 20, velocities + 20, count - 20, 0.05f);
+            REQUIRE(euler.size() == count && verlet.size() == count);
+
+            math::scalar dt = 0.01f;
+            math::vector3f p = positions[5], v = velocities[5];
+
+            for (int step = 0; step < 10; step++) {
+                euler.integrateEuler(dt, gravity, 0.5f);
+                threaded.integrateEuler(dt, gravity, 0.5f);
+                verlet.integrateVerlet(dt, gravity);
+
+                v = (v + gravity * dt) * (1 - 0.5f * dt);
+                p = p + v * dt;
+            }
+
+            math::scalar t = 10 * dt;
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::vector3f expected = positions[i] + velocities[i] * t + gravity * (0.5f * t * t);
+                REQUIRE(euler.position(i).x == threaded.position(i).x && euler.position(i).y == threaded.position(i).y && euler.velocity(i).z == threaded.velocity(i).z);
+                REQUIRE((verlet.position(i) - expected).length() < 0.0001f && (verlet.velocity(i) - velocities[i] - gravity * t).length() < 0.0001f);
+            }
+
+            REQUIRE((euler.position(5) - p).length() < 0.0001f && (euler.velocity(5) - v).length() < 0.0001f);
+            REQUIRE(std::abs(euler.age(0) - t) < 0.00001f);
+
+            // the last 17 particles expired, the rest keep their state
+            math::vector3f kept = verlet.position(3);
+            REQUIRE(verlet.killExpired() == count - 20 && verlet.size() == 20);
+            REQUIRE(verlet.position(3).x == kept.x && verlet.positions(1)[3] == kept.y);
+
+            math::vector3f last = euler.position(count - 1);
+            euler.kill(2);
+            REQUIRE(euler.size() == count - 1 && euler.position(2).x == last.x && euler.velocities(2)[2] == euler.velocity(2).z);
+        }
+
+        void orientationIntegration() {
+            const std::size_t count = 11;
+            math::scalar qx[count], qy[count], qz[count], qw[count], wx[count], wy[count], wz[count];
+            math::quaternion expected[count];
+            math::matrix3f rotations[count], inertia[count];
+            math::vector3f inverseInertia[count];
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::scalar s = math::scalar(i);
+                math::quaternion q = math::quaternion(math::vector3f(1, s, 2 - s).normalized(), s * 0.4f);
+                qx[i] = q.x, qy[i] = q.y, qz[i] = q.z, qw[i] = q.w;
+                wx[i] = std::sin(s) * 3, wy[i] = 1, wz[i] = s * 0.5f - 2;
+                expected[i] = q;
+                inverseInertia[i] = {1, 0.5f + s, 2};
+            }
+
+            math::scalar dt = math::scalar(1.0 / 120.0);
+
+            for (int step = 0; step < 120; step++) {
+                math::batch::integrateOrientations(qx, qy, qz, qw, wx, wy, wz, count, dt, step % 4 == 3);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    math::vector3f w = {wx[i], wy[i], wz[i]};
+                    expected[i] = (expected[i] * math::quaternion(w.normalized(), w.length() * dt)).normalized();
+                }
+            }
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::quaternion q = {qx[i], qy[i], qz[i], qw[i]};
+                REQUIRE(std::abs(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w - 1) < 0.0001f);
+                REQUIRE(std::abs(q.x - expected[i].x) < 0.001f && std::abs(q.y - expected[i].y) < 0.001f && std::abs(q.w - expected[i].w) < 0.001f);
+            }
+
+            math::batch::toMatrices(qx, qy, qz, qw, count, rotations);
+            math::batch::rotateInertia(rotations, inverseInertia, count, inertia);
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::matrix3f diagonal = {inverseInertia[i].x, 0, 0, 0, inverseInertia[i].y, 0, 0, 0, inverseInertia[i].z};
+                REQUIRE(equal(rotations[i], math::matrix3f(math::quaternion(qx[i], qy[i], qz[i], qw[i]))));
+                REQUIRE(equal(inertia[i], rotations[i].transposed() * diagonal * rotations[i]));
+            }
+        }
+
+        void inverseKinematics() {
+            math::vector3f a = {1, 0, 0};
+            REQUIRE(equal(a.transformed(a.rotationTo({0, 2, 0})), {0, 1, 0}));
+            REQUIRE(equal(a.transformed(a.rotationTo({-3, 0, 0})), {-1, 0, 0}));
+            REQUIRE(equal(math::vector3f(1, 2, 3).transformed(math::vector3f(1, 2, 3).rotationTo({-2, 0.5f, 1})), math::vector3f(-2, 0.5f, 1).normalized(std::sqrt(14.0f))));
+
+            math::quaternion q = math::quaternion(math::vector3f(0, 1, 0), 0.7f) * math::quaternion(math::vector3f(1, 0, 1).normalized(), 0.4f);
+            math::quaternion swing, twist;
+            q.swingTwist({0, 1, 0}, swing, twist);
+            REQUIRE(equal(twist * swing, q) && equal(twist.x, 0) && equal(twist.z, 0) && equal(swing.y, 0));
+
+            // 5 joints, 4 bones of length 1 along x
+            const std::size_t joints = 5, chains = 20;
+            math::vector3f straight[joints] = {{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {3, 0, 0}, {4, 0, 0}};
+            math::vector3f target = {2, 2, 1};
+
+            for (math::IKMethod method : {math::IKMethod::CCD, math::IKMethod::FABRIK}) {
+                math::vector3f positions[joints];
+                math::quaternion orientations[joints];
+                std::copy(straight, straight + joints, positions);
+                std::fill(orientations, orientations + joints, math::quaternion::identity());
+
+                bool reached = method == math::IKMethod::CCD ? math::solveCCD(positions, orientations, joints, target) : math::solveFABRIK(positions, orientations, joints, target);
+                REQUIRE(reached && positions[4].distanceTo(target) <= 0.001f && equal(positions[0], {0, 0, 0}));
+
+                for (std::size_t i = 0; i + 1 < joints; i++) {
+                    REQUIRE(std::abs(positions[i].distanceTo(positions[i + 1]) - 1) < 0.0001f);
+                    REQUIRE(math::vector3f(1, 0, 0).transformed(orientations[i]).distanceTo(positions[i + 1] - positions[i]) < 0.0001f);
+                }
+            }
+
+            math::vector3f positions[joints];
+            std::copy(straight, straight + joints, positions);
+            bool unreachable = !math::solveFABRIK(positions, nullptr, joints, {0, 10, 0});
+            REQUIRE(unreachable && equal(positions[4], {0, 4, 0}));
+
+            // batch gives the same as solving chains one by one
+            std::vector<math::vector3f> batch, single;
+            std::size_t offsets[chains + 1];
+            math::vector3f targets[chains];
+
+            for (std::size_t c = 0; c < chains; c++) {
+                batch.insert(batch.end(), straight, straight + joints - c % 2);
+                offsets[c + 1] = batch.size();
+                targets[c] = {std::sin(math::scalar(c)) * 3, 1, std::cos(math::scalar(c)) * 6};
+            }
+
+            offsets[0] = 0;
+            single = batch;
+
+            for (math::IKMethod method : {math::IKMethod::CCD, math::IKMethod::FABRIK}) {
+                std::size_t reached = 0;
+                math::IKOptions options;
+                options.threadCount = 3;
+
+                for (std::size_t c = 0; c < chains; c++) {
+                    math::vector3f *chain = single.data() + offsets[c];
+                    std::size_t count = offsets[c + 1] - offsets[c];
+                    reached += method == math::IKMethod::CCD ? math::solveCCD(chain, nullptr, count, targets[c]) : math::solveFABRIK(chain, nullptr, count, targets[c]);
+                }
+
+                std::size_t batchReached = math::solveChains(method, batch.data(), nullptr, offsets, targets, chains, options);
+                REQUIRE(batchReached == reached && reached > 0 && reached < chains);
+
+                for (std::size_t i = 0; i < batch.size(); i++) {
+                    REQUIRE(batch[i].x == single[i].x && batch[i].y == single[i].y && batch[i].z == single[i].z);
+                }
+            }
+        }
+
+        void intersection2Batch() {
+            const std::size_t count = 37;
+            math::scalar ax0[count], ay0[count], ax1[count], ay1[count], bx0[count], by0[count], bx1[count], by1[count];
+            math::scalar t[count], t0[count], t1[count];
+            std::uint8_t hits[count], convex[count], concave[count], clipped[count];
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::scalar s = math::scalar(i);
+                ax0[i] = std::sin(s * 1.3f) * 3, ay0[i] = std::cos(s * 0.7f) * 3, ax1[i] = std::sin(s * 2.1f) * 3, ay1[i] = std::cos(s * 1.9f) * 3;
+                bx0[i] = std::cos(s * 1.1f) * 3, by0[i] = std::sin(s * 0.3f) * 3, bx1[i] = std::cos(s * 2.7f) * 3, by1[i] = std::sin(s * 1.7f) * 3;
+            }
+
+            // crossing, parallel, touching at the end
+            ax0[0] = -1, ay0[0] = 0, ax1[0] = 1, ay1[0] = 0, bx0[0] = 0, by0[0] = -1, bx1[0] = 0, by1[0] = 3;
+            ax0[1] = 0, ay0[1] = 0, ax1[1] = 1, ay1[1] = 1, bx0[1] = 0, by0[1] = 1, bx1[1] = 1, by1[1] = 2;
+            ax0[2] = 0, ay0[2] = 0, ax1[2] = 2, ay1[2] = 0, bx0[2] = 2, by0[2] = -1, bx1[2] = 2, by1[2] = 1;
+
+            math::SegmentArrays a = {ax0, ay0, ax1, ay1}, b = {bx0, by0, bx1, by1};
+            math::batch::intersect(a, b, count, hits, t);
+            REQUIRE(hits[0] == 1 && equal(t[0], 0.5f) && hits[1] == 0 && hits[2] == 1 && equal(t[2], 1));
+
+            for (std::size_t i = 0; i < count; i++) {
+                double dax = ax1[i] - ax0[i], day = ay1[i] - ay0[i], dbx = bx1[i] - bx0[i], dby = by1[i] - by0[i];
+                double ex = bx0[i] - ax0[i], ey = by0[i] - ay0[i], d = dax * dby - day * dbx;
+                double tt = (ex * dby - ey * dbx) / d, uu = (ex * day - ey * dax) / d;
+                bool expected = d != 0 && tt >= 0 && tt <= 1 && uu >= 0 && uu <= 1;
+                REQUIRE(hits[i] == expected && (!expected || std::abs(t[i] - tt) < 0.0001));
+            }
+
+            // clockwise square and an L-shape
+            math::vector2f square[4] = {{-1, -1}, {-1, 1}, {1, 1}, {1, -1}};
+            math::vector2f shape[6] = {{-2, -2}, {2, -2}, {2, 0}, {0, 0}, {0, 2}, {-2, 2}};
+            math::batch::insideConvex(ax0, ay0, count, square, 4, convex);
+            math::batch::insidePolygon(ax0, ay0, count, shape, 6, concave);
+
+            for (std::size_t i = 0; i < count; i++) {
+                REQUIRE(convex[i] == (std::abs(ax0[i]) <= 1 && std::abs(ay0[i]) <= 1));
+                REQUIRE(i < 3 || concave[i] == (std::abs(ax0[i]) < 2 && std::abs(ay0[i]) < 2 && (ax0[i] < 0 || ay0[i] < 0)));
+            }
+
+            // bound clipping: through, outside, parallel inside and on the boundary
+            math::bound2f bound = {-1, -1, 1, 1};
+            ax0[3] = -3, ay0[3] = 0, ax1[3] = 1, ay1[3] = 0;
+            ax0[4] = -3, ay0[4] = 2, ax1[4] = 3, ay1[4] = 2;
+            ax0[5] = 0.5f, ay0[5] = -5, ax1[5] = 0.5f, ay1[5] = 5;
+            ax0[6] = 1, ay0[6] = 0, ax1[6] = 1, ay1[6] = 0.5f;
+            math::batch::clip(a, count, bound, clipped, t0, t1);
+            REQUIRE(clipped[3] == 1 && equal(t0[3], 0.5f) && equal(t1[3], 1) && clipped[4] == 0);
+            REQUIRE(clipped[5] == 1 && equal(t0[5], 0.4f) && equal(t1[5], 0.6f) && clipped[6] == 1 && equal(t0[6], 0) && equal(t1[6], 1));
+
+            for (std::size_t i = 7; i < count; i++) {
+                bool expected = false;
+
+                // dense sampling as the reference, the segments are not tangent to the bound
+                for (int k = 0; k <= 10000 && !expected; k++) {
+                    math::scalar u = math::scalar(k) / 10000;
+                    expected = bound.contains({ax0[i] + (ax1[i] - ax0[i]) * u, ay0[i] + (ay1[i] - ay0[i]) * u});
+                }
+
+                REQUIRE(clipped[i] == expected);
+            }
+        }
+
+        void batchDispatch() {
+            const std::size_t count = 45;  // full blocks and a tail for every instruction set
+            math::vector2f v2[count], r2[count], e2[count];
+            math::vector3f v3[count], r3[count], e3[count], t3[count], et3[count], st3[count];
+            math::quaternion q[count], rq[count], eq[count];
+            math::bound3f bounds[count];
+            math::color colors[count], rc[count], ec[count];
+            std::uint32_t rgba[count], ergba[count], visible[count], evisible[count];
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::scalar s = math::scalar(i);
+                v2[i] = {s - 20, std::sin(s) * 10};
+                v3[i] = {s - 20, std::sin(s) * 10, std::cos(s * 0.3f) * 30};
+                q[i] = {std::sin(s), std::cos(s * 2), s * 0.1f, -1};
+                bounds[i] = {v3[i].x - 1, v3[i].y - 1, v3[i].z - 1, v3[i].x + 1, v3[i].y + 1, v3[i].z + 1};
+                colors[i] = {s / 44, std::abs(std::sin(s)), 1 - s / 44, 0.5f};
+            }
+
+            v3[7] = {0, 0, 0};
+            q[40] = {0, 0, 0, 0};
+
+            math::transform3f trfm = math::transform3f::lookAtRH({1, 2, 3}, {0, 0, 0}, {0, 1, 0});
+            math::transform3f view = math::transform3f::lookAtRH({0, 0, 5}, {0, 0, 0}, {0, 1, 0});
+            math::transform3f viewProjection = view * math::transform3f::perspectiveFovRH(math::PI_2, math::scalar(800.0 / 600.0), 1, 100);
+            math::vector4f planes[6];
+            math::imp::frustumPlanes(viewProjection, planes);
+
+            bool selected = math::dispatch::select(math::BatchIsa::Generic);
+            REQUIRE(selected && math::dispatch::selectedIsa() == math::BatchIsa::Generic);
+            math::dispatch::transform(v3, et3, count, trfm, true);
+            math::dispatch::normalize(v2, e2, count, true);
+            math::dispatch::normalize(v3, e3, count, true);
+            math::dispatch::normalize(q, eq, count, true);
+            math::dispatch::convert(colors, ergba, count);
+            std::size_t evisibleCount = math::dispatch::cull(bounds, count, viewProjection, evisible);
+
+            REQUIRE(evisibleCount > 0 && evisibleCount < count);
+
+            // vector kernels sum transform terms pairwise, unlike the scalar method: SSE2 gives the bits for the wider sets
+            math::batch::transform(v3, st3, count, trfm, true);
+
+            auto close = [](math::scalar a, math::scalar b) { return std::abs(a - b) <= 0.000001f * (1 + std::abs(b)); };
+        #ifdef __FMA__
+            auto same = close;  // baseline kernels may be fused
+        #else
+            auto same = [](math::scalar a, math::scalar b) { return a == b; };
+        #endif
+
+            for (std::size_t i = 0, k = 0; i < count; i++) {
+                bool inside = k < evisibleCount && evisible[k] == i;
+                k += inside ? 1 : 0;
+                REQUIRE(inside == math::imp::boundInFrustum(bounds[i], planes));
+                REQUIRE(ergba[i] == unsigned(colors[i]));
+            }
+
+            for (math::BatchIsa isa : {math::BatchIsa::SSE2, math::BatchIsa::AVX2, math::BatchIsa::AVX512}) {
+                if (!math::dispatch::select(isa)) {
+                    REQUIRE(isa > math::dispatch::supportedIsa());
+                    continue;
+                }
+
+                math::dispatch::transform(v3, t3, count, trfm, true);
+                math::dispatch::normalize(v2, r2, count, true);
+                math::dispatch::normalize(v3, r3, count, true);
+                math::dispatch::normalize(q, rq, count, true);
+                math::dispatch::convert(colors, rgba, count);
+                math::dispatch::convert(rgba, rc, count);
+                math::dispatch::select(math::BatchIsa::Generic);
+                math::dispatch::convert(rgba, ec, count);
+                selected = math::dispatch::select(isa);
+                std::size_t visibleCount = math::dispatch::cull(bounds, count, viewProjection, visible);
+                REQUIRE(selected && visibleCount == evisibleCount);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    REQUIRE(same(t3[i].x, st3[i].x) && same(t3[i].y, st3[i].y) && same(t3[i].z, st3[i].z) && close(t3[i].x, et3[i].x) && close(t3[i].y, et3[i].y) && close(t3[i].z, et3[i].z));
+                    REQUIRE(same(r2[i].x, e2[i].x) && same(r2[i].y, e2[i].y));
+                    REQUIRE(same(r3[i].x, e3[i].x) && same(r3[i].y, e3[i].y) && same(r3[i].z, e3[i].z));
+                    REQUIRE(same(rq[i].x, eq[i].x) && same(rq[i].y, eq[i].y) && same(rq[i].z, eq[i].z) && same(rq[i].w, eq[i].w));
+                    REQUIRE(rgba[i] == ergba[i] && rc[i].r == ec[i].r && rc[i].g == ec[i].g && rc[i].b == ec[i].b && rc[i].a == ec[i].a);
+                    REQUIRE(i >= evisibleCount || visible[i] == evisible[i]);
+                }
+
+                // fast normalization only has to be close
+                math::dispatch::normalize(v3, r3, count);
+                math::dispatch::normalize(q, rq, count);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    REQUIRE(equal(r3[i], e3[i]) && std::abs(rq[i].x - eq[i].x) < 0.00001f && std::abs(rq[i].w - eq[i].w) < 0.00001f);
+                }
+            }
+
+            selected = math::dispatch::select(math::dispatch::supportedIsa());
+            REQUIRE(selected);
+        }
+
+        void textParsing() {
+            math::vector2f v2;
+            math::vector3f v3;
+            math::quaternion q;
+            math::transform3f t;
+            math::color c;
+            utility::TextScanner scanner ("{1, 2} { -3.5,4e1 ,0.25}\n{0, 0, 0, 1} {1,0,0,0, 0,1,0,0, 0,0,1,0, 5,6,7,1} {1, 0.5, 0, 1}");
+
+            scanner >> v2 >> v3 >> q >> t >> c;
+            REQUIRE(bool(scanner));
+            REQUIRE(scanner.eof());
+            REQUIRE(equal(v2, {1, 2}));
+            REQUIRE(equal(v3, {-3.5, 40, 0.25}));
+            REQUIRE(equal(q, math::quaternion::identity()));
+            REQUIRE(equal(t.translation(), {5, 6, 7}));
+            REQUIRE(equal(c.g, 0.5));
+
+            utility::TextScanner broken ("{1; 2}");
+            broken >> v2;
+            REQUIRE(!broken);
+
+            char buffer[256];
+            utility::TextPrinter printer (buffer);
+            printer << v3 << ' ' << t;
+            REQUIRE(bool(printer));
+            REQUIRE(printer.text().substr(0, 17) == "{-3.5, 40, 0.25} ");
+
+            math::vector3f v3r;
+            math::transform3f tr;
+            utility::TextScanner roundtrip (printer.text());
+            roundtrip >> v3r >> tr;
+            REQUIRE(bool(roundtrip));
+            REQUIRE(equal(v3r, v3));
+            REQUIRE(equal(tr.translation(), t.translation()));
+
+            char small[8];
+            utility::TextPrinter overflow (small);
+            overflow << v3;
+            std::string_view failedText = overflow.text();
+            overflow << 'x' << std::string_view("y");
+            REQUIRE(!overflow);
+            REQUIRE(overflow.text() == failedText);
+        }
+
+        void arrayArchive() {
+            const char *path = "math_tests_archive.bin";
+            math::vector3f points[1000];
+            math::quaternion rotations[3] = {math::quaternion::identity(), {{0, 1, 0}, math::PI_2}, {{1, 0, 0}, math::PI_6}};
+
+            for (int i = 0; i < 1000; i++) {
+                points[i] = {math::scalar(i), math::scalar(-i), math::scalar(i) * math::scalar(0.5)};
+            }
+
+            math::ArrayFileWriter writer;
+            bool opened = writer.open(path);
+            bool begun = writer.beginArray<math::vector3f>("points");
+            bool written = true;
+            REQUIRE(opened && begun);
+
+            for (int i = 0; i < 1000; i += 100) {
+                written = writer.write(points + i, 100) && written;
+            }
+
+            bool mismatched = writer.write(rotations, 3);
+            REQUIRE(written && !mismatched);
+
+            begun = writer.beginArray<math::quaternion>("rotations");
+            written = writer.write(rotations, 3);
+            REQUIRE(begun && written);
+
+            begun = writer.beginArray<math::transform3f>("empty");
+            bool closed = writer.close();
+            REQUIRE(begun && closed);
+
+            math::ArrayFileReader reader;
+            opened = reader.open(path);
+            REQUIRE(opened);
+            REQUIRE(reader.arrayCount() == 3);
+            REQUIRE(std::strcmp(reader.arrayName(1), "rotations") == 0 && reader.arrayName(3) == nullptr);
+            REQUIRE(reader.isArrayOf<math::quaternion>(1) && !reader.isArrayOf<math::quaternion>(3) && reader.array<math::quaternion>(3).empty());
+
+            math::ArrayView<math::vector3f> readPoints = reader.array<math::vector3f>("points");
+            math::ArrayView<math::quaternion> readRotations = reader.array<math::quaternion>("rotations");
+
+            REQUIRE(readPoints.count == 1000);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(readPoints.data) % math::ARCHIVE_ALIGNMENT == 0);
+            REQUIRE(equal(readPoints[999], points[999]));
+            REQUIRE(readRotations.count == 3);
+            REQUIRE(equal(readRotations[1], rotations[1]));
+            REQUIRE(reader.array<math::transform3f>("empty").empty());
+            REQUIRE(reader.array<math::vector2f>("points").empty());
+
+            reader.close();
+
+            // array name without terminating zero makes the file invalid
+            std::FILE *file = std::fopen(path, "r+b");
+            REQUIRE(file != nullptr);
+            char name[48];
+            std::memset(name, 'x', sizeof(name));
+            bool patched = std::fseek(file, long(sizeof(math::imp::ArchiveFileHeader) + 16), SEEK_SET) == 0 && std::fwrite(name, sizeof(name), 1, file) == 1;
+            std::fclose(file);
+            REQUIRE(patched);
+
+            opened = reader.open(path);
+            REQUIRE(!opened && reader.arrayCount() == 0);
+            std::remove(path);
+        }
+
+        void pointCloudTransform() {
+            const char *inputPath = "math_tests_cloud_in.bin";
+            const char *outputPath = "math_tests_cloud_out.bin";
+            std::vector<math::vector3f> points (10003);
+            math::transform3f trfm = math::transform3f({1, 2, 3}, math::quaternion({0, 1, 0}, math::PI_6)).scaled({2, 2, 2});
+
+            for (std::size_t i = 0; i < points.size(); i++) {
+                math::scalar s = math::scalar(i);
+                points[i] = {std::sin(s), std::cos(s * math::scalar(0.3)), s * math::scalar(0.001)};
+            }
+
+            math::ArrayFileWriter writer;
+            bool opened = writer.open(inputPath);
+            bool begun = writer.beginArray<math::vector3f>("cloud");
+            bool written = writer.write(points.data(), points.size());
+            bool closed = writer.close();
+            REQUIRE(opened && begun && written && closed);
+
+            math::bound3f bound;
+            math::PointCloudOptions options;
+            options.threadCount = 3;
+            options.chunkPoints = 1000;
+            bool transformed = math::transformPointCloud(inputPath, outputPath, "cloud", trfm, bound, options);
+            bool missing = math::transformPointCloud(inputPath, outputPath, "missing", trfm, bound, options);
+            REQUIRE(transformed && !missing);
+
+            transformed = math::transformPointCloud(inputPath, outputPath, "cloud", trfm, bound, options);
+            REQUIRE(transformed);
+
+            math::ArrayFileReader reader;
+            opened = reader.open(outputPath);
+            REQUIRE(opened);
+            math::ArrayView<math::vector3f> result = reader.array<math::vector3f>("cloud");
+            REQUIRE(result.count == points.size());
+
+            math::scalar xmin = std::numeric_limits<math::scalar>::max();
+            math::scalar zmax = -std::numeric_limits<math::scalar>::max();
+
+            for (std::size_t i = 0; i < points.size(); i++) {
+                math::vector3f expected = points[i].transformed(trfm, true);
+                REQUIRE(std::abs(result[i].x - expected.x) <= 0.0001f && std::abs(result[i].y - expected.y) <= 0.0001f && std::abs(result[i].z - expected.z) <= 0.0001f);
+                xmin = std::min(xmin, result[i].x);
+                zmax = std::max(zmax, result[i].z);
+            }
+
+            REQUIRE(equal(bound.xmin, xmin));
+            REQUIRE(equal(bound.zmax, zmax));
+
+            reader.close();
+            std::remove(inputPath);
+            std::remove(outputPath);
+        }
+
+        // prints time per element of batch kernels against the scalar methods they replace
+        template <typename T, typename Single, typename Batch> void benchmark(const char *name, std::vector<T> &data, Single &&single, Batch &&batch) {
+            using clock = std::chrono::steady_clock;
+            std::vector<T> result (data.size());
+            double best[3] = {1e9, 1e9, 1e9};
+
+            for (int run = 0; run < 5; run++) {
+                clock::time_point t0 = clock::now();
+                for (std::size_t i = 0; i < data.size(); i++) {
+                    result[i] = single(data[i]);
+                }
+                clock::time_point t1 = clock::now();
+                batch(data.data(), result.data(), data.size(), true);
+                clock::time_point t2 = clock::now();
+                batch(data.data(), result.data(), data.size(), false);
+                clock::time_point t3 = clock::now();
+
+                best[0] = std::min(best[0], std::chrono::duration<double, std::nano>(t1 - t0).count() / double(data.size()));
+                best[1] = std::min(best[1], std::chrono::duration<double, std::nano>(t2 - t1).count() / double(data.size()));
+                best[2] = std::min(best[2], std::chrono::duration<double, std::nano>(t3 - t2).count() / double(data.size()));
+            }
+
+            std::printf("%-24s method %6.3f ns, batch exact %6.3f ns, batch fast %6.3f ns\n", name, best[0], best[1], best[2]);
+        }
+
+        void benchmarkNormalization() {
+            const std::size_t count = 1 << 20;
+            std::vector<math::vector2f> v2 (count);
+            std::vector<math::vector3f> v3 (count);
+            std::vector<math::quaternion> q (count);
+
+            for (std::size_t i = 0; i < count; i++) {
+                math::scalar s = math::scalar(i % 1000) * math::scalar(0.01);
+                v2[i] = {s + 1, s - 3};
+                v3[i] = {s + 1, s - 3, s * s};
+                q[i] = {s + 1, s - 3, s * s, 2};
+            }
+
+            benchmark("normalize vector2f", v2, [](const math::vector2f &v) { return v.normalized(); }, [](const math::vector2f *v, math::vector2f *r, std::size_t n, bool exact) { math::batch::normalize(v, r, n, exact); });
+            benchmark("normalize vector3f", v3, [](const math::vector3f &v) { return v.normalized(); }, [](const math::vector3f *v, math::vector3f *r, std::size_t n, bool exact) { math::batch::normalize(v, r, n, exact); });
+            benchmark("normalize quaternion", q, [](const math::quaternion &v) { return v.normalized(); }, [](const math::quaternion *v, math::quaternion *r, std::size_t n, bool exact) { math::batch::normalize(v, r, n, exact); });
+        }
     }
 
     void runTests() {
@@ -419,6 +1500,28 @@ namespace math {
         transform2Operating();
         transform3Construction();
         transform3Operating();
+        matrix3Operating();
+        trsOperating();
+        boundOperating();
+        collision2Operating();
+        broadphaseTracking();
+        predicatesExactness();
+        noiseEvaluation();
+        batchReductions();
+        batchNormalization();
+        batchProjection();
+        occlusionCulling();
+        particleIntegration();
+        orientationIntegration();
+        inverseKinematics();
+        intersection2Batch();
+        batchDispatch();
+        textParsing();
+        arrayArchive();
+        pointCloudTransform();
     }
-}
 
+    void runBenchmarks() {
+        benchmarkNormalization();
+    }
+}
@@ -1,4 +1,5 @@
 
 namespace math {
     void runTests();
+    void runBenchmarks();
 }
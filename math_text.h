@@ -0,0 +1,87 @@
+#pragma once
+
+// Text form of math types for utility::TextScanner / utility::TextPrinter.
+// Every type is a brace enclosed comma separated list of its components in memory order:
+//   vector3f    {x, y, z}
+//   quaternion  {x, y, z, w}
+//   transform3f {_11, _12, _13, _14, _21, ..., _44}
+//   color       {r, g, b, a}
+
+#include "common.h"
+#include "math.h"
+
+namespace math
+{
+    namespace imp {
+        template <std::size_t N> inline utility::TextScanner &scanFlat(utility::TextScanner &scanner, scalar *flat) {
+            utility::expect<'{'>(scanner) >> flat[0];
+
+            for (std::size_t i = 1; i < N; i++) {
+                utility::expect<','>(scanner) >> flat[i];
+            }
+
+            return utility::expect<'}'>(scanner);
+        }
+
+        template <std::size_t N> inline utility::TextPrinter &printFlat(utility::TextPrinter &printer, const scalar *flat) {
+            printer << '{' << flat[0];
+
+            for (std::size_t i = 1; i < N; i++) {
+                printer << ", " << flat[i];
+            }
+
+            return printer << '}';
+        }
+
+        // four separate members, for types without a flat array
+        inline utility::TextScanner &scanFields(utility::TextScanner &scanner, scalar &a, scalar &b, scalar &c, scalar &d) {
+            utility::expect<'{'>(scanner) >> a;
+            utility::expect<','>(scanner) >> b;
+            utility::expect<','>(scanner) >> c;
+            utility::expect<','>(scanner) >> d;
+            return utility::expect<'}'>(scanner);
+        }
+
+        inline utility::TextPrinter &printFields(utility::TextPrinter &printer, scalar a, scalar b, scalar c, scalar d) {
+            return printer << '{' << a << ", " << b << ", " << c << ", " << d << '}';
+        }
+    }
+
+    inline utility::TextScanner &operator >>(utility::TextScanner &scanner, vector2f &v) {
+        return imp::scanFlat<2>(scanner, v.flat2);
+    }
+    inline utility::TextScanner &operator >>(utility::TextScanner &scanner, vector3f &v) {
+        return imp::scanFlat<3>(scanner, v.flat3);
+    }
+    inline utility::TextScanner &operator >>(utility::TextScanner &scanner, vector4f &v) {
+        return imp::scanFlat<4>(scanner, v.flat4);
+    }
+    inline utility::TextScanner &operator >>(utility::TextScanner &scanner, quaternion &q) {
+        return imp::scanFields(scanner, q.x, q.y, q.z, q.w);
+    }
+    inline utility::TextScanner &operator >>(utility::TextScanner &scanner, transform3f &trfm) {
+        return imp::scanFlat<16>(scanner, trfm.flat16);
+    }
+    inline utility::TextScanner &operator >>(utility::TextScanner &scanner, color &c) {
+        return imp::scanFields(scanner, c.r, c.g, c.b, c.a);
+    }
+
+    inline utility::TextPrinter &operator <<(utility::TextPrinter &printer, const vector2f &v) {
+        return imp::printFlat<2>(printer, v.flat2);
+    }
+    inline utility::TextPrinter &operator <<(utility::TextPrinter &printer, const vector3f &v) {
+        return imp::printFlat<3>(printer, v.flat3);
+    }
+    inline utility::TextPrinter &operator <<(utility::TextPrinter &printer, const vector4f &v) {
+        return imp::printFlat<4>(printer, v.flat4);
+    }
+    inline utility::TextPrinter &operator <<(utility::TextPrinter &printer, const quaternion &q) {
+        return imp::printFields(printer, q.x, q.y, q.z, q.w);
+    }
+    inline utility::TextPrinter &operator <<(utility::TextPrinter &printer, const transform3f &trfm) {
+        return imp::printFlat<16>(printer, trfm.flat16);
+    }
+    inline utility::TextPrinter &operator <<(utility::TextPrinter &printer, const color &c) {
+        return imp::printFields(printer, c.r, c.g, c.b, c.a);
+    }
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+// Depth-only software rasterizer for CPU occlusion culling.
+// Occluder triangles are transformed by the view-projection of perspectiveFovLH/RH (depth 1 at near, 0 at far),
+// binned into screen tiles and rasterized tile by tile on worker threads into a low resolution depth buffer.
+// Every 8x8 block of the buffer keeps its farthest depth, so most occludee tests are answered by the blocks alone.
+//
+//   OcclusionBuffer occlusion (256, 128);
+//   occlusion.begin(view * projection);
+//   occlusion.rasterize(vertices, indices, triangleCount, world);
+//   std::size_t count = occlusion.cull(bounds, boundCount, visibleIndices);
+
+#include <cstdint>
+#include <vector>
+#include "common.h"
+#include "math.h"
+
+namespace math
+{
+    struct OcclusionOptions {
+        std::size_t threadCount = 0;  // 0 = std::thread::hardware_concurrency()
+    };
+
+    namespace imp {
+        constexpr int OCCLUSION_TILE = 32;
+        constexpr int OCCLUSION_BLOCK = 8;
+
+        // Edge functions e = a * x + b * y + c are non-negative inside, depth = za * x + zb * y + zc. Pixel bounds are inclusive.
+        struct OccluderTriangle {
+            scalar a[3], b[3], c[3];
+            scalar za, zb, zc;
+            int xmin, ymin, xmax, ymax;
+        };
+    }
+
+    // Pixel (x, y) covers [x, x + 1) x [y, y + 1), rows go from the top of the viewport down.
+    // Coverage is sampled at pixel centers, occludee tests cover every touched pixel.
+    class OcclusionBuffer {
+    public:
+        OcclusionBuffer(std::size_t width = 256, std::size_t height = 128, const OcclusionOptions &options = {}) : _options(options) {
+            _width = int(std::max(std::size_t(1), width));
+            _height = int(std::max(std::size_t(1), height));
+            _tilesX = (_width + imp::OCCLUSION_TILE - 1) / imp::OCCLUSION_TILE;
+            _tilesY = (_height + imp::OCCLUSION_TILE - 1) / imp::OCCLUSION_TILE;
+            _blocksX = _tilesX * (imp::OCCLUSION_TILE / imp::OCCLUSION_BLOCK);
+            _depth.resize(std::size_t(_tilesX * _tilesY) * imp::OCCLUSION_TILE * imp::OCCLUSION_TILE);
+            _blocks.resize(std::size_t(_blocksX) * _tilesY * (imp::OCCLUSION_TILE / imp::OCCLUSION_BLOCK));
+        }
+
+        std::size_t width() const {
+            return std::size_t(_width);
+        }
+
+        std::size_t height() const {
+            return std::size_t(_height);
+        }
+
+        // Clears the buffer to the far plane and sets projection for the following rasterize and test calls
+        void begin(const transform3f &viewProjection) {
+            _viewProjection = viewProjection;
+            std::fill(_depth.begin(), _depth.end(), scalar(0.0));
+            std::fill(_blocks.begin(), _blocks.end(), scalar(0.0));
+        }
+
+        // Triangles 'indices[3 * i] .. indices[3 * i + 2]' of 'vertices' placed by 'world'. Both windings are drawn.
+        // Triangles reaching behind the near plane are skipped, which only makes occlusion weaker.
+        void rasterize(const vector3f *vertices, const std::uint32_t *indices, std::size_t triangleCount, const transform3f &world = transform3f::identity()) {
+            std::size_t threadCount = _options.threadCount ? _options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+            std::size_t tileCount = std::size_t(_tilesX * _tilesY);
+            transform3f trfm = world * _viewProjection;
+
+            _triangles.resize(triangleCount);
+            _bins.resize(threadCount);
+
+            for (std::vector<std::vector<std::uint32_t>> &bins : _bins) {
+                bins.resize(tileCount);
+
+                for (std::vector<std::uint32_t> &bin : bins) {
+                    bin.clear();
+                }
+            }
+
+            utility::parallelFor(triangleCount, threadCount, 64, [&](std::size_t begin, std::size_t end, std::size_t slot) {
+                for (std::size_t i = begin; i < end; i++) {
+                    if (_setup(vertices, indices + 3 * i, trfm, _triangles[i])) {
+                        _bin(std::uint32_t(i), _bins[slot]);
+                    }
+                }
+            });
+
+            // tiles are disjoint, so threads never touch the same pixels
+            utility::parallelFor(tileCount, threadCount, 1, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t tile = begin; tile < end; tile++) {
+                    bool drawn = false;
+
+                    for (const std::vector<std::vector<std::uint32_t>> &bins : _bins) {
+                        for (std::uint32_t index : bins[tile]) {
+                            _draw(_triangles[index], int(tile));
+                            drawn = true;
+                        }
+                    }
+
+                    if (drawn) {
+                        _reduce(int(tile));
+                    }
+                }
+            });
+        }
+
+        // Nearest depth written at pixel, 0 where nothing was drawn
+        scalar depth(std::size_t x, std::size_t y) const {
+            return _depth[_index(int(x), int(y))];
+        }
+
+        // False if bound is outside of the frustum or behind the drawn occluders
+        bool visible(const bound3f &bound) const {
+            return _test(bound);
+        }
+
+        // Writes indices of visible bounds in increasing order, returns their number
+        std::size_t cull(const bound3f *bounds, std::size_t count, std::uint32_t *visibleIndices) const {
+            std::vector<std::uint8_t> flags (count);
+            std::size_t result = 0;
+
+            utility::parallelFor(count, _options.threadCount, 256, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t i = begin; i < end; i++) {
+                    flags[i] = _test(bounds[i]) ? 1 : 0;
+                }
+            });
+
+            for (std::size_t i = 0; i < count; i++) {
+                if (flags[i]) {
+                    visibleIndices[result++] = std::uint32_t(i);
+                }
+            }
+
+            return result;
+        }
+
+    private:
+        OcclusionOptions _options;
+        transform3f _viewProjection = transform3f::identity();
+        int _width, _height;
+        int _tilesX, _tilesY, _blocksX;
+
+        std::vector<scalar> _depth;   // tile after tile, rows of a tile are contiguous
+        std::vector<scalar> _blocks;  // farthest depth of every 8x8 block, row-major
+        std::vector<imp::OccluderTriangle> _triangles;
+        std::vector<std::vector<std::vector<std::uint32_t>>> _bins;  // [slot][tile] -> triangles
+
+        std::size_t _index(int x, int y) const {
+            int tile = (y / imp::OCCLUSION_TILE) * _tilesX + x / imp::OCCLUSION_TILE;
+            return std::size_t(tile) * imp::OCCLUSION_TILE * imp::OCCLUSION_TILE + (y % imp::OCCLUSION_TILE) * imp::OCCLUSION_TILE + x % imp::OCCLUSION_TILE;
+        }
+
+        vector2f _toPixels(const vector4f &clip) const {
+            return {(clip.x / clip.w + scalar(1.0)) * scalar(0.5) * scalar(_width), (scalar(1.0) - clip.y / clip.w) * scalar(0.5) * scalar(_height)};
+        }
+
+        // pixel coordinate clamped to [0, size] (NaN to 0) before conversion, so far off-screen values can't overflow int
+        static scalar _clamped(scalar v, int size) {
+            return v > scalar(0.0) ? (v < scalar(size) ? v : scalar(size)) : scalar(0.0);
+        }
+
+        bool _setup(const vector3f *vertices, const std::uint32_t *corners, const transform3f &trfm, imp::OccluderTriangle &t) const {
+            vector2f p[3];
+            scalar z[3];
+
+            for (int i = 0; i < 3; i++) {
+                vector4f clip = vector4f(vertices[corners[i]], scalar(1.0)).transformed(trfm);
+
+                if (clip.w <= scalar(0.0) || clip.z > clip.w) {
+                    return false;
+                }
+
+                p[i] = _toPixels(clip);
+                z[i] = clip.z / clip.w;
+            }
+
+            scalar area = (p[1] - p[0]).cross(p[2] - p[0]);
+
+            if (area == scalar(0.0)) {
+                return false;
+            }
+            if (area < scalar(0.0)) {
+                std::swap(p[1], p[2]);
+                std::swap(z[1], z[2]);
+                area = -area;
+            }
+
+            // e[i] is the edge opposite to vertex i, e[i] / area is the barycentric weight of it
+            for (int i = 0; i < 3; i++) {
+                const vector2f &from = p[(i + 1) % 3];
+                const vector2f &to = p[(i + 2) % 3];
+                t.a[i] = from.y - to.y;
+                t.b[i] = to.x - from.x;
+                t.c[i] = from.x * to.y - from.y * to.x;
+            }
+
+            scalar inv = scalar(1.0) / area;
+            t.za = (t.a[0] * z[0] + t.a[1] * z[1] + t.a[2] * z[2]) * inv;
+            t.zb = (t.b[0] * z[0] + t.b[1] * z[1] + t.b[2] * z[2]) * inv;
+            t.zc = (t.c[0] * z[0] + t.c[1] * z[1] + t.c[2] * z[2]) * inv;
+
+            t.xmin = int(std::floor(_clamped(std::min({p[0].x, p[1].x, p[2].x}), _width)));
+            t.ymin = int(std::floor(_clamped(std::min({p[0].y, p[1].y, p[2].y}), _height)));
+            t.xmax = std::min(_width - 1, int(std::ceil(_clamped(std::max({p[0].x, p[1].x, p[2].x}), _width))));
+            t.ymax = std::min(_height - 1, int(std::ceil(_clamped(std::max({p[0].y, p[1].y, p[2].y}), _height))));
+
+            return t.xmin <= t.xmax && t.ymin <= t.ymax;
+        }
+
+        void _bin(std::uint32_t index, std::vector<std::vector<std::uint32_t>> &bins) const {
+            const imp::OccluderTriangle &t = _triangles[index];
+
+            for (int ty = t.ymin / imp::OCCLUSION_TILE; ty <= t.ymax / imp::OCCLUSION_TILE; ty++) {
+                for (int tx = t.xmin / imp::OCCLUSION_TILE; tx <= t.xmax / imp::OCCLUSION_TILE; tx++) {
+                    bins[std::size_t(ty * _tilesX + tx)].push_back(index);
+                }
+            }
+        }
+
+        void _draw(const imp::OccluderTriangle &t, int tile) {
+            int tx = (tile % _tilesX) * imp::OCCLUSION_TILE;
+            int ty = (tile / _tilesX) * imp::OCCLUSION_TILE;
+            int xmin = std::max(t.xmin, tx), xmax = std::min(t.xmax, tx + imp::OCCLUSION_TILE - 1);
+            int ymin = std::max(t.ymin, ty), ymax = std::min(t.ymax, ty + imp::OCCLUSION_TILE - 1);
+            scalar *pixels = _depth.data() + std::size_t(tile) * imp::OCCLUSION_TILE * imp::OCCLUSION_TILE;
+
+            for (int y = ymin; y <= ymax; y++) {
+                scalar py = scalar(y) + scalar(0.5);
+                scalar r0 = t.b[0] * py + t.c[0], r1 = t.b[1] * py + t.c[1], r2 = t.b[2] * py + t.c[2], rz = t.zb * py + t.zc;
+                scalar *row = pixels + (y - ty) * imp::OCCLUSION_TILE - tx;
+
+                // branch-free, so the row vectorizes
+                for (int x = xmin; x <= xmax; x++) {
+                    scalar px = scalar(x) + scalar(0.5);
+                    bool inside = t.a[0] * px + r0 >= scalar(0.0) && t.a[1] * px + r1 >= scalar(0.0) && t.a[2] * px + r2 >= scalar(0.0);
+                    scalar z = t.za * px + rz;
+                    row[x] = inside && z > row[x] ? z : row[x];
+                }
+            }
+        }
+
+        void _reduce(int tile) {
+            constexpr int BLOCKS = imp::OCCLUSION_TILE / imp::OCCLUSION_BLOCK;
+            const scalar *pixels = _depth.data() + std::size_t(tile) * imp::OCCLUSION_TILE * imp::OCCLUSION_TILE;
+
+            for (int by = 0; by < BLOCKS; by++) {
+                for (int bx = 0; bx < BLOCKS; bx++) {
+                    scalar farthest = std::numeric_limits<scalar>::max();
+
+                    for (int y = 0; y < imp::OCCLUSION_BLOCK; y++) {
+                        const scalar *row = pixels + (by * imp::OCCLUSION_BLOCK + y) * imp::OCCLUSION_TILE + bx * imp::OCCLUSION_BLOCK;
+
+                        for (int x = 0; x < imp::OCCLUSION_BLOCK; x++) {
+                            farthest = std::min(farthest, row[x]);
+                        }
+                    }
+
+                    _blocks[std::size_t(((tile / _tilesX) * BLOCKS + by) * _blocksX + (tile % _tilesX) * BLOCKS + bx)] = farthest;
+                }
+            }
+        }
+
+        bool _test(const bound3f &bound) const {
+            vector2f min = {std::numeric_limits<scalar>::max(), std::numeric_limits<scalar>::max()};
+            vector2f max = -min;
+            scalar nearest = -std::numeric_limits<scalar>::max();
+            int outside[4] = {};
+
+            for (int i = 0; i < 8; i++) {
+                vector3f corner = {i & 1 ? bound.xmax : bound.xmin, i & 2 ? bound.ymax : bound.ymin, i & 4 ? bound.zmax : bound.zmin};
+                vector4f clip = vector4f(corner, scalar(1.0)).transformed(_viewProjection);
+
+                // corner in front of the near plane: nothing can be said about the screen rectangle
+                if (clip.w <= scalar(0.0) || clip.z > clip.w) {
+                    return true;
+                }
+
+                outside[0] += clip.x < -clip.w;
+                outside[1] += clip.x > clip.w;
+                outside[2] += clip.y < -clip.w;
+                outside[3] += clip.y > clip.w;
+
+                vector2f p = _toPixels(clip);
+                min = {std::min(min.x, p.x), std::min(min.y, p.y)};
+                max = {std::max(max.x, p.x), std::max(max.y, p.y)};
+                nearest = std::max(nearest, clip.z / clip.w);
+            }
+
+            if (outside[0] == 8 || outside[1] == 8 || outside[2] == 8 || outside[3] == 8 || nearest < scalar(0.0)) {
+                return false;
+            }
+
+            int xmin = int(std::floor(_clamped(min.x, _width))), xmax = std::min(_width - 1, int(std::floor(_clamped(max.x, _width))));
+            int ymin = int(std::floor(_clamped(min.y, _height))), ymax = std::min(_height - 1, int(std::floor(_clamped(max.y, _height))));
+
+            for (int by = ymin / imp::OCCLUSION_BLOCK; by <= ymax / imp::OCCLUSION_BLOCK; by++) {
+                for (int bx = xmin / imp::OCCLUSION_BLOCK; bx <= xmax / imp::OCCLUSION_BLOCK; bx++) {
+                    if (_blocks[std::size_t(by * _blocksX + bx)] >= nearest) {
+                        continue;
+                    }
+
+                    // block has something farther than the bound, look at the covered pixels of it
+                    int y0 = std::max(ymin, by * imp::OCCLUSION_BLOCK), y1 = std::min(ymax, by * imp::OCCLUSION_BLOCK + imp::OCCLUSION_BLOCK - 1);
+                    int x0 = std::max(xmin, bx * imp::OCCLUSION_BLOCK), x1 = std::min(xmax, bx * imp::OCCLUSION_BLOCK + imp::OCCLUSION_BLOCK - 1);
+
+                    for (int y = y0; y <= y1; y++) {
+                        for (int x = x0; x <= x1; x++) {
+                            if (_depth[_index(x, y)] < nearest) {
+                                return true;
+                            }
+                        }
+                    }
+                }
+            }
+
+            return false;
+        }
+    };
+}
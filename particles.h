@@ -0,0 +1,219 @@
+#pragma once
+
+// Particle storage as separate arrays of components (SoA), integrated 4 particles per step with SSE2.
+// Order of particles is not kept: killed particles are replaced by the last ones.
+//
+//   ParticleBuffer particles;
+//   particles.emit(positions, velocities, count, lifetime);
+//   particles.integrateEuler(dt, gravity);
+//   particles.killExpired();
+//   render(particles.positions(0), particles.positions(1), particles.positions(2), particles.size());
+
+#include <vector>
+#include "common.h"
+#include "math_batch.h"
+
+namespace math
+{
+    struct ParticleOptions {
+        std::size_t threadCount = 0;     // 0 = std::thread::hardware_concurrency()
+        std::size_t granularity = 4096;  // particles per thread at least
+    };
+
+    namespace imp {
+        struct ParticleArrays {
+            scalar *p[3];
+            scalar *v[3];
+            scalar *age;
+        };
+
+        // Semi-implicit Euler: v += a * dt, v *= keep, p += v * dt
+        // Velocity Verlet:     p += (v + a * dt / 2) * dt, v += a * dt, v *= keep (exact for constant acceleration without damping)
+        template <bool Verlet> void integrateParticles(const ParticleArrays &arrays, std::size_t begin, std::size_t end, scalar dt, const vector3f &acceleration, scalar keep) {
+            const scalar dv[3] = {acceleration.x * dt, acceleration.y * dt, acceleration.z * dt};
+            const scalar half = scalar(0.5);
+            std::size_t i = begin;
+
+        #ifdef MATH_BATCH_SSE2
+            for (; i + 4 <= end; i += 4) {
+                for (std::size_t k = 0; k < 3; k++) {
+                    __m128 p = _mm_loadu_ps(arrays.p[k] + i);
+                    __m128 v = _mm_loadu_ps(arrays.v[k] + i);
+                    __m128 a = _mm_set1_ps(dv[k]);
+
+                    if (Verlet) {
+                        p = _mm_add_ps(p, _mm_mul_ps(_mm_add_ps(v, _mm_mul_ps(a, _mm_set1_ps(half))), _mm_set1_ps(dt)));
+                        v = _mm_mul_ps(_mm_add_ps(v, a), _mm_set1_ps(keep));
+                    }
+                    else {
+                        v = _mm_mul_ps(_mm_add_ps(v, a), _mm_set1_ps(keep));
+                        p = _mm_add_ps(p, _mm_mul_ps(v, _mm_set1_ps(dt)));
+                    }
+
+                    _mm_storeu_ps(arrays.p[k] + i, p);
+                    _mm_storeu_ps(arrays.v[k] + i, v);
+                }
+
+                _mm_storeu_ps(arrays.age + i, _mm_add_ps(_mm_loadu_ps(arrays.age + i), _mm_set1_ps(dt)));
+            }
+        #endif
+
+            for (; i < end; i++) {
+                for (std::size_t k = 0; k < 3; k++) {
+                    scalar &p = arrays.p[k][i];
+                    scalar &v = arrays.v[k][i];
+
+                    if (Verlet) {
+                        p = p + (v + dv[k] * half) * dt;
+                        v = (v + dv[k]) * keep;
+                    }
+                    else {
+                        v = (v + dv[k]) * keep;
+                        p = p + v * dt;
+                    }
+                }
+
+                arrays.age[i] = arrays.age[i] + dt;
+            }
+        }
+    }
+
+    class ParticleBuffer {
+    public:
+        ParticleBuffer(const ParticleOptions &options = {}) : _options(options) {}
+
+        std::size_t size() const {
+            return _age.size();
+        }
+
+        void reserve(std::size_t capacity) {
+            for (std::size_t k = 0; k < 3; k++) {
+                _p[k].reserve(capacity);
+                _v[k].reserve(capacity);
+            }
+
+            _age.reserve(capacity);
+            _lifetime.reserve(capacity);
+        }
+
+        // Appends 'count' particles of zero age at the end of the arrays
+        void emit(const vector3f *positions, const vector3f *velocities, std::size_t count, scalar lifetime) {
+            std::size_t first = size();
+
+            for (std::size_t k = 0; k < 3; k++) {
+                _p[k].resize(first + count);
+                _v[k].resize(first + count);
+            }
+            for (std::size_t i = 0; i < count; i++) {
+                _p[0][first + i] = positions[i].x;
+                _p[1][first + i] = positions[i].y;
+                _p[2][first + i] = positions[i].z;
+                _v[0][first + i] = velocities[i].x;
+                _v[1][first + i] = velocities[i].y;
+                _v[2][first + i] = velocities[i].z;
+            }
+
+            _age.resize(first + count, scalar(0.0));
+            _lifetime.resize(first + count, lifetime);
+        }
+
+        vector3f position(std::size_t index) const {
+            return {_p[0][index], _p[1][index], _p[2][index]};
+        }
+
+        vector3f velocity(std::size_t index) const {
+            return {_v[0][index], _v[1][index], _v[2][index]};
+        }
+
+        scalar age(std::size_t index) const {
+            return _age[index];
+        }
+
+        // component arrays of size() elements: axis 0, 1, 2 = x, y, z
+        const scalar *positions(std::size_t axis) const {
+            return _p[axis].data();
+        }
+
+        const scalar *velocities(std::size_t axis) const {
+            return _v[axis].data();
+        }
+
+        // Moves the last particle into 'index'
+        void kill(std::size_t index) {
+            std::size_t last = size() - 1;
+
+            for (std::size_t k = 0; k < 3; k++) {
+                _p[k][index] = _p[k][last];
+                _v[k][index] = _v[k][last];
+                _p[k].pop_back();
+                _v[k].pop_back();
+            }
+
+            _age[index] = _age[last];
+            _lifetime[index] = _lifetime[last];
+            _age.pop_back();
+            _lifetime.pop_back();
+        }
+
+        // Kills particles with age >= lifetime, returns their number
+        std::size_t killExpired() {
+            std::size_t count = size();
+            std::size_t i = 0;
+
+            // going forward keeps every particle moved from the end checked as well
+            while (i < count) {
+                if (_age[i] >= _lifetime[i]) {
+                    count--;
+
+                    for (std::size_t k = 0; k < 3; k++) {
+                        _p[k][i] = _p[k][count];
+                        _v[k][i] = _v[k][count];
+                    }
+
+                    _age[i] = _age[count];
+                    _lifetime[i] = _lifetime[count];
+                }
+                else {
+                    i++;
+                }
+            }
+
+            std::size_t killed = size() - count;
+
+            for (std::size_t k = 0; k < 3; k++) {
+                _p[k].resize(count);
+                _v[k].resize(count);
+            }
+
+            _age.resize(count);
+            _lifetime.resize(count);
+            return killed;
+        }
+
+        // Steps all particles by 'dt' under constant 'acceleration'. 'damping' is the fraction of velocity lost per second.
+        void integrateEuler(scalar dt, const vector3f &acceleration, scalar damping = scalar(0.0)) {
+            _integrate<false>(dt, acceleration, damping);
+        }
+
+        void integrateVerlet(scalar dt, const vector3f &acceleration, scalar damping = scalar(0.0)) {
+            _integrate<true>(dt, acceleration, damping);
+        }
+
+    private:
+        ParticleOptions _options;
+        std::vector<scalar> _p[3];
+        std::vector<scalar> _v[3];
+        std::vector<scalar> _age;
+        std::vector<scalar> _lifetime;
+
+        template <bool Verlet> void _integrate(scalar dt, const vector3f &acceleration, scalar damping) {
+            imp::ParticleArrays arrays = {{_p[0].data(), _p[1].data(), _p[2].data()}, {_v[0].data(), _v[1].data(), _v[2].data()}, _age.data()};
+            scalar keep = std::max(scalar(0.0), scalar(1.0) - damping * dt);
+
+            // slices are multiples of 4, so only the last one has a scalar tail
+            utility::parallelFor(size(), _options.threadCount, std::max(std::size_t(4), _options.granularity & ~std::size_t(3)), [&](std::size_t begin, std::size_t end, std::size_t) {
+                imp::integrateParticles<Verlet>(arrays, begin, end, dt, acceleration, keep);
+            });
+        }
+    };
+}
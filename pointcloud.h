@@ -0,0 +1,95 @@
+#pragma once
+
+// Out-of-core processing of vector3f arrays stored in math_archive.h files.
+// Input array is mapped window by window, the next window is prefetched while worker threads transform the current one,
+// and the transformed window is written by a background task while the next one is being computed.
+
+#include <future>
+#include "common.h"
+#include "math_batch.h"
+#include "math_archive.h"
+
+namespace math
+{
+    struct PointCloudOptions {
+        std::size_t threadCount = 0;                  // 0 = std::thread::hardware_concurrency()
+        std::size_t chunkPoints = std::size_t(1) << 20;  // points per mapped window (12 MB)
+    };
+
+    // Transforms vector3f array 'name' of archive 'inputPath' by 'trfm' as positions and writes it with the same name into new archive 'outputPath'.
+    // 'bound' receives bound of the transformed points. False if input array is not found or any IO fails.
+    inline bool transformPointCloud(const char *inputPath, const char *outputPath, const char *name, const transform3f &trfm, bound3f &bound, const PointCloudOptions &options = {}) {
+        utility::MappedFile input;
+        ArrayFileWriter writer;
+        std::uint64_t offset = 0, count = 0;
+
+        if (!input.open(inputPath) || !findArchiveArray<vector3f>(input, name, offset, count)) {
+            return false;
+        }
+        if (!writer.open(outputPath) || !writer.beginArray<vector3f>(name)) {
+            return false;
+        }
+
+        std::size_t threadCount = options.threadCount ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+        std::size_t chunkPoints = std::max(std::size_t(4), options.chunkPoints);
+        std::vector<vector3f> buffers[2] = {std::vector<vector3f>(chunkPoints), std::vector<vector3f>(chunkPoints)};
+        std::vector<bound3f> bounds (threadCount);
+        std::future<bool> pendingWrite;
+
+        bound = bound3f::empty();
+
+        auto window = [&](std::uint64_t first) {
+            std::size_t points = std::size_t(std::min(std::uint64_t(chunkPoints), count - first));
+            return input.map(offset + first * sizeof(vector3f), points * sizeof(vector3f));
+        };
+
+        utility::MappedView current = count ? window(0) : utility::MappedView();
+        bool result = true;
+
+        for (std::uint64_t first = 0, chunk = 0; result && first < count; first += chunkPoints, chunk++) {
+            std::size_t points = std::size_t(std::min(std::uint64_t(chunkPoints), count - first));
+            utility::MappedView next;
+
+            if (first + points < count) {
+                next = window(first + points);
+                next.prefetch();
+            }
+            if (current.size() != points * sizeof(vector3f)) {
+                result = false;
+                break;
+            }
+
+            const vector3f *source = reinterpret_cast<const vector3f *>(current.data());
+            vector3f *target = buffers[chunk & 1].data();
+
+            for (bound3f &b : bounds) {
+                b = bound3f::empty();
+            }
+
+            utility::parallelFor(points, threadCount, 4, [&](std::size_t begin, std::size_t end, std::size_t slot) {
+                batch::transform(source + begin, target + begin, end - begin, trfm, true);
+                bounds[slot] = batch::boundOf(target + begin, end - begin);
+            });
+
+            bound = bound.merged(batch::merged(bounds.data(), bounds.size()));
+
+            // the other buffer must be on disk before it is reused by the next chunk, no more writes after a failed one
+            if (pendingWrite.valid() && !pendingWrite.get()) {
+                result = false;
+                break;
+            }
+
+            pendingWrite = std::async(std::launch::async, [&writer, target, points] {
+                return writer.write(target, points);
+            });
+
+            current = std::move(next);
+        }
+
+        if (pendingWrite.valid()) {
+            result = pendingWrite.get() && result;
+        }
+
+        return writer.close() && result;
+    }
+}